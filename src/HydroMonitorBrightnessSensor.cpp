@@ -15,10 +15,10 @@ void HydroMonitorBrightnessSensor::begin(HydroMonitorCore::SensorData *sd, Hydro
 
 #if defined(USE_TSL2561)
   tsl = TSL2561(TSL2561_ADDR_FLOAT, 12345);
-  l->writeTrace(F("HydroMonitorBrightnessSensor: configured TSL2561 sensor."));
+  l->writeTrace(LOG_MODULE_BRIGHTNESSSENSOR, F("HydroMonitorBrightnessSensor: configured TSL2561 sensor."));
 #elif defined(USE_TSL2591)
   tsl = TSL2591();
-  l->writeTrace(F("HydroMonitorBrightnessSensor: configured TSL2591 sensor."));
+  l->writeTrace(LOG_MODULE_BRIGHTNESSSENSOR, F("HydroMonitorBrightnessSensor: configured TSL2591 sensor."));
 #endif
 
   logging = l;
@@ -15,18 +15,18 @@ HydroMonitorCirculation::HydroMonitorCirculation() {
 void HydroMonitorCirculation::begin(HydroMonitorCore::SensorData *sd, HydroMonitorLogging *l, Adafruit_MCP23017* mcp23017) {
   mcp = mcp23017;
   mcp->pinMode(CIRCULATION_MCP17_PIN, OUTPUT);
-  l->writeTrace(F("HydroMonitorCirculation: configured circulation pump on MCP23017 port expander."));
+  l->writeTrace(LOG_MODULE_CIRCULATION, F("HydroMonitorCirculation: configured circulation pump on MCP23017 port expander."));
 
 #elif defined(CIRCULATION_MCP_PIN)                          // Connected to MCP23008 port expander.
 void HydroMonitorCirculation::begin(HydroMonitorCore::SensorData * sd, HydroMonitorLogging * l, Adafruit_MCP23008 * mcp23008) {
   mcp = mcp23008;
   mcp->pinMode(CIRCULATION_MCP_PIN, OUTPUT);
-  l->writeTrace(F("HydroMonitorCirculation: configured circulation pump on MCP23008 port expander."));
+  l->writeTrace(LOG_MODULE_CIRCULATION, F("HydroMonitorCirculation: configured circulation pump on MCP23008 port expander."));
 
 #elif defined(CIRCULATION_PIN)                              // Connected to GPIO port.
 void HydroMonitorCirculation::begin(HydroMonitorCore::SensorData * sd, HydroMonitorLogging * l) {
   pinMode(CIRCULATION_PIN, OUTPUT);
-  l->writeTrace(F("HydroMonitorCirculation: configured circulation pump."));
+  l->writeTrace(LOG_MODULE_CIRCULATION, F("HydroMonitorCirculation: configured circulation pump."));
 #endif                                                      // endif pin definitions.
   sensorData = sd;
   logging = l;
@@ -87,7 +87,7 @@ void HydroMonitorCirculation::updateSettings(ESP8266WebServer * server) {
    Swich pump on.
 */
 void HydroMonitorCirculation::switchPumpOn() {
-  logging->writeTrace(F("HydroMonitorCirculation: switching on circulation pump."));
+  logging->writeTrace(LOG_MODULE_CIRCULATION, F("HydroMonitorCirculation: switching on circulation pump."));
 #ifdef CIRCULATION_PIN
   digitalWrite(CIRCULATION_PIN, HIGH);
 #elif defined(CIRCULATION_MCP_PIN)
@@ -102,7 +102,7 @@ void HydroMonitorCirculation::switchPumpOn() {
    Swich pump off.
 */
 void HydroMonitorCirculation::switchPumpOff() {
-  logging->writeTrace(F("HydroMonitorCirculation: switching off circulation pump."));
+  logging->writeTrace(LOG_MODULE_CIRCULATION, F("HydroMonitorCirculation: switching off circulation pump."));
 #ifdef CIRCULATION_PIN
   digitalWrite(p, LOW);
 #elif defined(CIRCULATION_MCP_PIN)
@@ -0,0 +1,331 @@
+#include <HydroMonitorConnection.h>
+
+/*
+   Keep-alive HTTP connection to the logging server.
+*/
+
+/*
+   The constructor.
+*/
+HydroMonitorConnection::HydroMonitorConnection() {
+  host[0] = 0;
+}
+
+/*
+   Set the host to connect to. A change of host closes the current connection and clears the DNS cache.
+*/
+void HydroMonitorConnection::setHost(const char* h, uint16_t p) {
+  if (strcmp(host, h) != 0 || port != p) {
+    stop();
+    strlcpy(host, h, sizeof(host));
+    port = p;
+    resolved = false;
+  }
+}
+
+/*
+   Close the connection, abandoning the request in progress (if any).
+*/
+void HydroMonitorConnection::stop() {
+  client.stop();
+  state = STATE_IDLE;
+}
+
+/*
+   Whether a request is in progress.
+*/
+bool HydroMonitorConnection::busy() {
+  return state != STATE_IDLE;
+}
+
+/********************************************************************************************************************
+   Start a request for path (including the query string) to the host: a GET request, or a POST request if a body
+   is given. The connection is reused if it's still open. Call poll() until it returns the result.
+*/
+void HydroMonitorConnection::start(const char* path, const char* body) {
+  requestPath = path;
+  requestBody = body;
+  retried = false;
+  timing.connect = 0;
+  timing.send = 0;
+  timing.response = 0;
+  state = STATE_CONNECT;
+}
+
+/********************************************************************************************************************
+   Do the next bit of work on the request in progress.
+   Returns CONNECTION_BUSY while the request is in progress; then the HTTP response code, or a negative
+   CONNECTION_* code on failure.
+*/
+int16_t HydroMonitorConnection::poll() {
+  switch (state) {
+    case STATE_IDLE:                                        // Nothing to do; return the result of the last request.
+      return responseCode;
+
+    case STATE_CONNECT: {
+      reused = client.connected();
+      if (reused == false) {
+        uint32_t start = millis();
+        if (resolve() == false) {
+          return finish(CONNECTION_DNS_FAILED);
+        }
+        if (connect() == false) {
+          resolved = false;                                 // The IP address may have changed; resolve again next time.
+          return finish(CONNECTION_CONNECT_FAILED);
+        }
+        timing.connect = millis() - start;
+      }
+      state = STATE_SEND;
+      return CONNECTION_BUSY;
+    }
+
+    case STATE_SEND: {
+      uint32_t start = millis();
+      bool sent = sendRequest();
+      timing.send = millis() - start;
+      if (sent == false) {
+        return retry(CONNECTION_SEND_FAILED);
+      }
+      state = STATE_STATUS;
+      stateStart = millis();
+      lineLength = 0;
+      return CONNECTION_BUSY;
+    }
+
+    default:
+      return receive();
+  }
+}
+
+/********************************************************************************************************************
+   Send a request, and wait for the result.
+*/
+int16_t HydroMonitorConnection::request(const char* path, const char* body) {
+  start(path, body);
+  int16_t result;
+  while ((result = poll()) == CONNECTION_BUSY) {
+    yield();
+  }
+  return result;
+}
+
+/********************************************************************************************************************
+   Resolve the host name, unless we have a recent cached IP address.
+*/
+bool HydroMonitorConnection::resolve() {
+  if (resolved && millis() - resolvedTime < DNS_CACHE_TIME) {
+    return true;
+  }
+  resolved = (WiFi.hostByName(host, hostIP, DNS_TIMEOUT) == 1);
+  resolvedTime = millis();
+  return resolved;
+}
+
+/********************************************************************************************************************
+   Open the TCP connection to the cached IP address.
+*/
+bool HydroMonitorConnection::connect() {
+  client.setTimeout(TCP_CONNECT_TIMEOUT);
+  return client.connect(hostIP, port);
+}
+
+/********************************************************************************************************************
+   Write the request header - and body, if any - to the connection.
+*/
+bool HydroMonitorConnection::sendRequest() {
+  client.print((requestBody) ? F("POST ") : F("GET "));
+  client.print(requestPath);
+  client.print(F(" HTTP/1.1\r\nHost: "));
+  client.print(host);
+  client.print(F("\r\nUser-Agent: HydroMonitor\r\nConnection: keep-alive\r\n"));
+  if (requestBody) {
+    client.print(F("Content-Type: text/plain\r\nContent-Length: "));
+    client.print(strlen(requestBody));
+    client.print(F("\r\n"));
+  }
+  client.print(F("\r\n"));
+  if (requestBody) {
+    client.write((const uint8_t*)requestBody, strlen(requestBody));
+  }
+  return client.connected();
+}
+
+/********************************************************************************************************************
+   Handle the response bytes that have come in, at most MAX_POLL_BYTES of them: the status line and the headers
+   we need are parsed, the body is discarded.
+*/
+int16_t HydroMonitorConnection::receive() {
+  uint16_t budget = MAX_POLL_BYTES;
+  while (budget > 0) {
+    size_t available = client.available();
+    if (available == 0) {
+      if (client.connected() == false) {
+        return closed();
+      }
+      if (millis() - stateStart > RESPONSE_TIMEOUT) {
+        keepAlive = false;
+        return finish((state >= STATE_BODY) ? responseCode : CONNECTION_TIMEOUT);
+      }
+      return CONNECTION_BUSY;                               // Wait for more.
+    }
+    if (state == STATE_BODY || state == STATE_BODY_UNTIL_CLOSED || state == STATE_CHUNK) {
+      uint8_t scratch[32];
+      size_t n = min(available, sizeof(scratch));
+      if (remaining >= 0) {
+        n = min(n, (size_t)remaining);
+      }
+      n = client.read(scratch, n);
+      budget -= min((size_t)budget, n);
+      if (remaining >= 0) {
+        remaining -= n;
+        if (remaining == 0) {
+          if (state == STATE_BODY) {
+            return finish(responseCode);
+          }
+          state = STATE_CHUNK_SIZE;
+        }
+      }
+    }
+    else {
+      budget--;
+      char c = client.read();
+      if (c == '\n') {
+        line[lineLength] = 0;
+        uint8_t n = lineLength;
+        lineLength = 0;
+        int16_t result = handleLine(n);
+        if (result != CONNECTION_BUSY) {
+          return result;
+        }
+      }
+      else if (c != '\r' && lineLength < sizeof(line) - 1) { // Excess characters are dropped.
+        line[lineLength] = c;
+        lineLength++;
+      }
+    }
+  }
+  return CONNECTION_BUSY;
+}
+
+/********************************************************************************************************************
+   Handle a complete response line of n characters, without the CR/LF.
+*/
+int16_t HydroMonitorConnection::handleLine(uint8_t n) {
+  switch (state) {
+    case STATE_STATUS:                                      // Status line: HTTP/1.1 200 OK
+      if (n < 12 || strncmp_P(line, PSTR("HTTP/1."), 7) != 0) {
+        keepAlive = false;
+        return finish(CONNECTION_INVALID_RESPONSE);
+      }
+      keepAlive = (line[7] == '1');                         // HTTP/1.1 defaults to keep-alive; HTTP/1.0 to close.
+      if (line[8] != ' ' || isDigit(line[9]) == false || isDigit(line[10]) == false || isDigit(line[11]) == false ||
+          (n > 12 && line[12] != ' ')) {                    // The status code must be three digits.
+        keepAlive = false;
+        return finish(CONNECTION_INVALID_RESPONSE);
+      }
+      responseCode = atoi(line + 9);
+      if (responseCode < 100 || responseCode > 599) {
+        keepAlive = false;
+        return finish(CONNECTION_INVALID_RESPONSE);
+      }
+      remaining = -1;
+      chunked = false;
+      state = STATE_HEADERS;
+      break;
+
+    case STATE_HEADERS:
+      if (n == 0) {                                         // Empty line: end of the headers.
+        if (chunked) {
+          state = STATE_CHUNK_SIZE;
+        }
+        else if (remaining == 0) {
+          return finish(responseCode);
+        }
+        else if (remaining > 0) {
+          state = STATE_BODY;
+        }
+        else {                                              // No length given: body ends when the server closes the connection.
+          keepAlive = false;
+          state = STATE_BODY_UNTIL_CLOSED;
+        }
+      }
+      else if (strncasecmp_P(line, PSTR("Content-Length:"), 15) == 0) {
+        remaining = atol(line + 15);
+      }
+      else if (strncasecmp_P(line, PSTR("Transfer-Encoding:"), 18) == 0) {
+        chunked = (strstr_P(line, PSTR("chunked")) != NULL);
+      }
+      else if (strncasecmp_P(line, PSTR("Connection:"), 11) == 0) {
+        keepAlive = (strstr_P(line, PSTR("close")) == NULL);
+      }
+      break;
+
+    case STATE_CHUNK_SIZE: {                                // The chunk size, in hex.
+      uint32_t chunkSize = strtoul(line, NULL, 16);
+      if (chunkSize == 0) {                                 // Last chunk; skip the (usually empty) trailer.
+        state = STATE_TRAILER;
+      }
+      else {
+        remaining = chunkSize + 2;                          // The chunk and its trailing CRLF.
+        state = STATE_CHUNK;
+      }
+      break;
+    }
+
+    case STATE_TRAILER:
+      if (n == 0) {
+        return finish(responseCode);
+      }
+      break;
+
+    default:
+      break;
+  }
+  return CONNECTION_BUSY;
+}
+
+/********************************************************************************************************************
+   The server closed the connection.
+*/
+int16_t HydroMonitorConnection::closed() {
+  keepAlive = false;
+  if (state >= STATE_BODY) {                                // We have the response code; failing to read the body doesn't matter.
+    return finish(responseCode);
+  }
+  if (state == STATE_STATUS && lineLength == 0) {           // Closed before sending anything.
+    return retry(CONNECTION_TIMEOUT);
+  }
+  return finish(CONNECTION_TIMEOUT);
+}
+
+/********************************************************************************************************************
+   The request failed before any response came in. A reused connection may have been closed by the server while
+   idle; then try once more on a fresh connection. Otherwise the request fails with result.
+*/
+int16_t HydroMonitorConnection::retry(int16_t result) {
+  client.stop();
+  if (reused && retried == false) {
+    retried = true;
+    state = STATE_CONNECT;
+    return CONNECTION_BUSY;
+  }
+  return finish(result);
+}
+
+/********************************************************************************************************************
+   The request is complete.
+*/
+int16_t HydroMonitorConnection::finish(int16_t result) {
+  if (result == CONNECTION_BUSY) {                          // Not a result: poll() would report busy forever.
+    result = CONNECTION_INVALID_RESPONSE;
+  }
+  if (result < 0 || keepAlive == false) {                   // Server wants the connection closed, or it's unusable.
+    client.stop();
+  }
+  if (state >= STATE_STATUS) {
+    timing.response = millis() - stateStart;
+  }
+  responseCode = result;
+  state = STATE_IDLE;
+  return result;
+}
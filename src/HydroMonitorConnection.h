@@ -0,0 +1,105 @@
+/*
+   HydroMonitorConnection
+
+   A long-lived HTTP/1.1 connection to the logging server.
+
+   The host name is resolved once and the IP address cached for DNS_CACHE_TIME; the TCP connection is kept
+   open (keep-alive) and reused for subsequent requests until the server closes it. Response bodies are read
+   and discarded in a small stack buffer, nothing is allocated on the heap.
+
+   Requests are handled by a state machine, so the caller is never blocked waiting for the server: start() sets
+   up the request, and each call to poll() does a small slice of the work - send the request, parse what has
+   come in of the response - and returns CONNECTION_BUSY until the request is complete. The host name lookup
+   and the TCP connect are still blocking calls, but with short timeouts (DNS_TIMEOUT, TCP_CONNECT_TIMEOUT);
+   with the DNS cache and keep-alive they are needed only now and then.
+   The path and body passed to start() must remain valid until the request is complete.
+
+   request() is the blocking version, for use outside of the main loop.
+
+   Both return the HTTP response code, or one of the negative CONNECTION_* error codes.
+   After each request the timing of the connect, send and response phases is available in timing.
+
+*/
+
+#ifndef HYDROMONITORCONNECTION_H
+#define HYDROMONITORCONNECTION_H
+
+#include <ESP8266WiFi.h>
+
+const uint32_t DNS_CACHE_TIME = 60 * 60 * 1000ul;           // Resolve the host name again after 1 hour.
+const uint16_t RESPONSE_TIMEOUT = 5000;                     // Time to wait for the server to respond (ms).
+const uint16_t DNS_TIMEOUT = 1000;                          // Time to wait for the host name lookup (ms).
+const uint16_t TCP_CONNECT_TIMEOUT = 1000;                  // Time to wait for the TCP connection (ms).
+const uint16_t MAX_POLL_BYTES = 256;                        // Maximum number of response bytes to handle per poll().
+
+const int16_t CONNECTION_BUSY = 0;                          // Request in progress.
+
+const int16_t CONNECTION_DNS_FAILED = -1;                   // Could not resolve the host name.
+const int16_t CONNECTION_CONNECT_FAILED = -2;               // Could not open a connection to the server.
+const int16_t CONNECTION_SEND_FAILED = -3;                  // Connection lost while sending the request.
+const int16_t CONNECTION_TIMEOUT = -4;                      // No (complete) response within RESPONSE_TIMEOUT.
+const int16_t CONNECTION_INVALID_RESPONSE = -5;             // The response could not be parsed.
+
+class HydroMonitorConnection
+{
+  public:
+
+    struct Timing {
+      uint32_t connect;                                     // Time to resolve & connect (ms); 0 if the connection was reused.
+      uint32_t send;                                        // Time to send the request (ms).
+      uint32_t response;                                    // Time from sent request to complete response (ms).
+    };
+
+    HydroMonitorConnection();
+    void setHost(const char*, uint16_t = 80);
+    void start(const char*, const char* = NULL);
+    int16_t poll();
+    bool busy();
+    int16_t request(const char*, const char* = NULL);
+    void stop();
+    Timing timing;
+
+  private:
+    enum ConnectionStates {
+      STATE_IDLE,                                           // No request in progress.
+      STATE_CONNECT,                                        // Resolve the host name and open the connection if needed.
+      STATE_SEND,                                           // Send the request.
+      STATE_STATUS,                                         // Wait for the status line.
+      STATE_HEADERS,                                        // Read the headers.
+      STATE_BODY,                                           // Discard a body of known length.
+      STATE_BODY_UNTIL_CLOSED,                              // Discard a body of unknown length.
+      STATE_CHUNK_SIZE,                                     // Read the size line of the next chunk.
+      STATE_CHUNK,                                          // Discard a chunk.
+      STATE_TRAILER,                                        // Skip the trailer after the last chunk.
+    };
+
+    bool resolve();
+    bool connect();
+    bool sendRequest();
+    int16_t receive();
+    int16_t handleLine(uint8_t);
+    int16_t closed();
+    int16_t retry(int16_t);
+    int16_t finish(int16_t);
+
+    ConnectionStates state = STATE_IDLE;
+    const char* requestPath;
+    const char* requestBody;
+    bool reused;                                            // The request went out on a connection that was already open.
+    bool retried;                                           // We already tried again on a fresh connection.
+    uint32_t stateStart;                                    // When the current phase started (ms).
+    char line[64];                                          // The response line being read.
+    uint8_t lineLength;
+    int16_t responseCode = CONNECTION_INVALID_RESPONSE;     // Result of the request.
+    int32_t remaining;                                      // Bytes left of the body or the current chunk; -1 if not known.
+    bool chunked;
+
+    WiFiClient client;
+    char host[101];
+    uint16_t port;
+    IPAddress hostIP;
+    bool resolved = false;
+    uint32_t resolvedTime;
+    bool keepAlive;                                         // Whether the server allows us to keep the connection open.
+};
+#endif
@@ -27,6 +27,29 @@ const uint8_t LOG_ERROR =     2;                            // errors
 const uint8_t LOG_OFF =       1;                            // no logging
 const uint16_t MAX_MESSAGE_SIZE = 500;                      // Maximum allowed message size.
 
+// The modules, each with its own log level. Stored in EEPROM: only add new ones at the end.
+const uint8_t LOG_MODULE_MAIN =                 0;          // The sketch, and messages without a module.
+const uint8_t LOG_MODULE_LOGGING =              1;
+const uint8_t LOG_MODULE_NETWORK =              2;
+const uint8_t LOG_MODULE_ECSENSOR =             3;
+const uint8_t LOG_MODULE_PHSENSOR =             4;
+const uint8_t LOG_MODULE_WATERTEMPSENSOR =      5;
+const uint8_t LOG_MODULE_WATERLEVELSENSOR =     6;
+const uint8_t LOG_MODULE_BRIGHTNESSSENSOR =     7;
+const uint8_t LOG_MODULE_TEMPERATURESENSOR =    8;
+const uint8_t LOG_MODULE_HUMIDITYSENSOR =       9;
+const uint8_t LOG_MODULE_PRESSURESENSOR =       10;
+const uint8_t LOG_MODULE_FLOWSENSOR =           11;
+const uint8_t LOG_MODULE_ISOLATEDSENSORBOARD =  12;
+const uint8_t LOG_MODULE_GROWLIGHT =            13;
+const uint8_t LOG_MODULE_CIRCULATION =          14;
+const uint8_t LOG_MODULE_DRAINAGE =             15;
+const uint8_t LOG_MODULE_FERTILISER =           16;
+const uint8_t LOG_MODULE_PHMINUS =              17;
+const uint8_t LOG_MODULE_RESERVOIR =            18;
+const uint8_t LOG_MODULE_GROWINGPARAMETERS =    19;
+const uint8_t LOG_MODULES =                     20;         // Number of modules.
+
 // WiFi server settings.
 const uint16_t CONNECT_TIMEOUT = 30;                        // Seconds
 const uint16_t CONNECT_OK = 0;                              // Status of successful connection to WiFi
@@ -71,6 +94,8 @@ const uint8_t STATUS_DRAINAGE_NEEDED        = 6;            // Request immediate
 #ifndef USE_WATERLEVEL_SENSOR
 const uint8_t STATUS_RESERVOIR_DRAINED      = 7;            // Reservoir is empty, needs to be filled. Use this flag if not using water level sensor.
 #endif
+const uint8_t STATUS_DOSING_FERTILISER      = 8;            // A fertiliser pump is running.
+const uint8_t STATUS_DOSING_PHMINUS         = 9;            // The pH-minus pump is running.
 //const uint8_t STATUS_
 //const uint8_t STATUS_
 
@@ -102,7 +127,9 @@ const uint16_t OTA_PASSWORD_EEPROM = 408;                   // 32 bytes
 const uint16_t GROWING_PARAMETERS_EEPROM = 456;             // 84 bytes
 const uint16_t LOGGING_EEPROM = 556;                        // 317 bytes
 const uint16_t DRAINAGE_EEPROM = 889;                       // 4 bytes
-const uint16_t FREE_EEPROM = 909;                           // Above this address it's free to use.
+const uint16_t LOG_LEVELS_EEPROM = 909;                     // 20 bytes
+const uint16_t LOG_SEQUENCE_EEPROM = 929;                   // 4 bytes
+const uint16_t FREE_EEPROM = 949;                           // Above this address it's free to use.
 
 // Datapoints for the sensor calibration.
 // Each datapoint is 4+4+4+4+1 = 17 bytes.
@@ -16,18 +16,18 @@ HydroMonitorDrainage::HydroMonitorDrainage() {
 void HydroMonitorDrainage::begin(HydroMonitorCore::SensorData *sd, HydroMonitorLogging *l, Adafruit_MCP23017* mcp23017, HydroMonitorWaterLevelSensor* sens) {
   mcp = mcp23017;
   mcp->pinMode(DRAINAGE_MCP17_PIN, OUTPUT);
-  l->writeTrace(F("HydroMonitorDrainage: configured drainage pump on MCP23017 port expander."));
+  l->writeTrace(LOG_MODULE_DRAINAGE, F("HydroMonitorDrainage: configured drainage pump on MCP23017 port expander."));
 
 #elif defined(DRAINAGE_MCP_PIN)   // Connected to MCP23008 port expander.
 void HydroMonitorDrainage::begin(HydroMonitorCore::SensorData * sd, HydroMonitorLogging * l, Adafruit_MCP23008 * mcp23008, HydroMonitorWaterLevelSensor * sens) {
   mcp = mcp23008;
   mcp->pinMode(DRAINAGE_MCP_PIN, OUTPUT);
-  l->writeTrace(F("HydroMonitorDrainage: configured drainage pump on MCP23008 port expander."));
+  l->writeTrace(LOG_MODULE_DRAINAGE, F("HydroMonitorDrainage: configured drainage pump on MCP23008 port expander."));
 
 #elif defined(DRAINAGE_PIN)         // Connected to GPIO port.
 void HydroMonitorDrainage::begin(HydroMonitorCore::SensorData * sd, HydroMonitorLogging * l, HydroMonitorWaterLevelSensor * sens) {
   pinMode(DRAINAGE_PIN, OUTPUT);
-  l->writeTrace(F("HydroMonitorDrainage: configured drainage pump."));
+  l->writeTrace(LOG_MODULE_DRAINAGE, F("HydroMonitorDrainage: configured drainage pump."));
 #endif
   waterLevelSensor = sens;
 #else                                                       // Not using water level sensor.
@@ -35,18 +35,18 @@ void HydroMonitorDrainage::begin(HydroMonitorCore::SensorData * sd, HydroMonitor
 void HydroMonitorDrainage::begin(HydroMonitorCore::SensorData *sd, HydroMonitorLogging *l, Adafruit_MCP23017* mcp23017) {
   mcp = mcp23017;
   mcp->pinMode(DRAINAGE_MCP17_PIN, OUTPUT);
-  l->writeTrace(F("HydroMonitorDrainage: configured drainage pump on MCP23017 port expander."));
+  l->writeTrace(LOG_MODULE_DRAINAGE, F("HydroMonitorDrainage: configured drainage pump on MCP23017 port expander."));
 
 #elif defined(DRAINAGE_MCP_PIN)   // Connected to MCP23008 port expander.
 void HydroMonitorDrainage::begin(HydroMonitorCore::SensorData * sd, HydroMonitorLogging * l, Adafruit_MCP23008 * mcp23008) {
   mcp = mcp23008;
   mcp->pinMode(DRAINAGE_MCP_PIN, OUTPUT);
-  l->writeTrace(F("HydroMonitorDrainage: configured drainage pump on MCP23008 port expander."));
+  l->writeTrace(LOG_MODULE_DRAINAGE, F("HydroMonitorDrainage: configured drainage pump on MCP23008 port expander."));
 
 #elif defined(DRAINAGE_PIN)         // Connected to GPIO port.
 void HydroMonitorDrainage::begin(HydroMonitorCore::SensorData * sd, HydroMonitorLogging * l) {
   pinMode(DRAINAGE_PIN, OUTPUT);
-  l->writeTrace(F("HydroMonitorDrainage: configured drainage pump."));
+  l->writeTrace(LOG_MODULE_DRAINAGE, F("HydroMonitorDrainage: configured drainage pump."));
 #endif                                                      // endif pin definitions.
 #endif                                                      // endif USE_WATERLEVEL_SENSOR
   sensorData = sd;
@@ -61,7 +61,7 @@ void HydroMonitorDrainage::begin(HydroMonitorCore::SensorData * sd, HydroMonitor
   switchPumpOff();
 
   if (settings.drainageInterval < 1 || settings.drainageInterval > 400) {
-    logging->writeTrace(F("HydroMonitorDrainage: applying default settings."));
+    logging->writeTrace(LOG_MODULE_DRAINAGE, F("HydroMonitorDrainage: applying default settings."));
     settings.drainageInterval = 60;
     if (timeStatus() != timeNotSet && now() > 1546300800) { // midnight, 1 Jan 2019.
       settings.latestDrainage = now();
@@ -86,7 +86,7 @@ void HydroMonitorDrainage::doDrainage() {
     bitClear(sensorData->systemStatus, STATUS_DRAINAGE_NEEDED);
     if (drainageState == DRAINAGE_IDLE) {
       drainageState = DRAINAGE_DRAIN_EXCESS;
-      logging->writeInfo(F("HydroMonitorDrainage: immediate drainage requested."));
+      logging->writeInfo(LOG_MODULE_DRAINAGE, F("HydroMonitorDrainage: immediate drainage requested."));
       settings.latestDrainage = now();
       drainageStart = millis();    
     }
@@ -119,12 +119,12 @@ void HydroMonitorDrainage::doDrainage() {
     case DRAINAGE_IDLE:
       if (now() > settings.latestDrainage + (uint32_t)settings.drainageInterval * 24 * 60 * 60) {
         drainageState = DRAINAGE_AUTOMATIC_DRAINING_START;
-        logging->writeInfo(F("HydroMonitorDrainage: scheduled full drainage of the reservoir: solution maintenance."));
+        logging->writeInfo(LOG_MODULE_DRAINAGE, F("HydroMonitorDrainage: scheduled full drainage of the reservoir: solution maintenance."));
       }
 #ifdef USE_WATERLEVEL_SENSOR
       else if (millis() - lastGoodFill > (uint32_t)2 * 60 * 1000) { // Drain some water if fill level is >95% for >2 minutes.
         drainageState = DRAINAGE_DRAIN_EXCESS;
-        logging->writeWarning(F("Drainage 01: reservoir fill level too high for more than 2 minutes; draining the excess."));
+        logging->writeWarning(MESSAGE_DRAINAGE_01);
       }
 #endif
       break;
@@ -134,7 +134,7 @@ void HydroMonitorDrainage::doDrainage() {
     case DRAINAGE_AUTOMATIC_DRAINING_START:
       if ((bitRead(sensorData->systemStatus, STATUS_WATERING) ||
            bitRead(sensorData->systemStatus, STATUS_DOOR_OPEN)) == false) {
-        logging->writeTrace(F("Start automatic draining sequence."));
+        logging->writeTrace(LOG_MODULE_DRAINAGE, F("Start automatic draining sequence."));
         switchPumpOn();
         drainageState = DRAINAGE_AUTOMATIC_DRAINING_RUNNING;
         drainageStart = millis();
@@ -152,11 +152,11 @@ void HydroMonitorDrainage::doDrainage() {
 #endif
         drainageCompletedTime = millis();
         drainageState = DRAINAGE_AUTOMATIC_DRAINING_COMPLETE;
-        logging->writeTrace(F("Automatic draining sequence emptied reservoir; continue 60 seconds."));
+        logging->writeTrace(LOG_MODULE_DRAINAGE, F("Automatic draining sequence emptied reservoir; continue 60 seconds."));
       }
       if (millis() - drainageStart > (uint32_t)20 * 60 * 1000) {
         if (millis() - lastWarned > WARNING_INTERVAL) {
-          logging->writeError(F("Drainage 02: Automatic draining sequence not completed in 20 minutes; possible pump malfunction."));
+          logging->writeError(MESSAGE_DRAINAGE_02);
           lastWarned = millis();
         }
       }
@@ -164,7 +164,7 @@ void HydroMonitorDrainage::doDrainage() {
 
     case DRAINAGE_AUTOMATIC_DRAINING_COMPLETE:
       if (millis() - drainageCompletedTime > (uint32_t)60 * 1000) { // Continue to pump for 60 seconds to make sure the reservoir is really empty.
-        logging->writeTrace(F("Automatic draining sequence completed."));
+        logging->writeTrace(LOG_MODULE_DRAINAGE, F("Automatic draining sequence completed."));
         switchPumpOff();
         settings.latestDrainage = now();
         lastDrainageRun = millis();
@@ -205,14 +205,14 @@ void HydroMonitorDrainage::doDrainage() {
 #endif
         drainageCompletedTime = millis();
         drainageState = DRAINAGE_MANUAL_DRAINING_HOLD_EMPTY;
-        logging->writeTrace(F("Manual draining sequence emptied reservoir; continue 60 seconds."));
+        logging->writeTrace(LOG_MODULE_DRAINAGE, F("Manual draining sequence emptied reservoir; continue 60 seconds."));
       }
       break;
 
     case DRAINAGE_MANUAL_DRAINING_HOLD_EMPTY:
       if (millis() - drainageCompletedTime > (uint32_t)60 * 1000) { // Continue to pump for 60 seconds to make sure the reservoir is really empty.
         switchPumpOff();
-        logging->writeTrace(F("Manual draining sequence completed."));
+        logging->writeTrace(LOG_MODULE_DRAINAGE, F("Manual draining sequence completed."));
         drainageState = DRAINAGE_MANUAL_DRAINING_COMPLETE;
         lastDrainageRun = millis();
         if (now() > 1546300800) {                               // Only store time if it makes sense to do so.
@@ -263,11 +263,11 @@ void HydroMonitorDrainage::doDrainage() {
         drainageState = DRAINAGE_IDLE;
         bitClear(sensorData->systemStatus, STATUS_MAINTENANCE);
         switchPumpOff();
-        logging->writeTrace(F("HydroMonitorDrainage: reservoir drained to <90% fill level."));
+        logging->writeTrace(LOG_MODULE_DRAINAGE, F("HydroMonitorDrainage: reservoir drained to <90% fill level."));
       }
       if (millis() - drainageStart > (uint32_t)20 * 60 * 1000) {
         if (millis() - lastWarned > WARNING_INTERVAL) {
-          logging->writeError(F("Drainage 03: drainage of the excess not completed within 20 minutes; possible malfunction."));
+          logging->writeError(MESSAGE_DRAINAGE_03);
           lastWarned = millis();
         }
       }
@@ -277,7 +277,7 @@ void HydroMonitorDrainage::doDrainage() {
         drainageState = DRAINAGE_IDLE;
         bitClear(sensorData->systemStatus, STATUS_MAINTENANCE);
         switchPumpOff();
-        logging->writeTrace(F("HydroMonitorDrainage: reservoir emergency drainage complete."));
+        logging->writeTrace(LOG_MODULE_DRAINAGE, F("HydroMonitorDrainage: reservoir emergency drainage complete."));
         bitSet(sensorData->systemStatus, STATUS_RESERVOIR_DRAINED); // Allow refilling of the reservoir when we're done.
       }
 #endif
@@ -347,13 +347,13 @@ bool HydroMonitorDrainage::autoDrainageMode() {
 }
 
 void HydroMonitorDrainage::drainStart() {
-  logging->writeTrace(F("HydroMonitorDrainage::drainStart(): Starting manual drainage sequence - into maintenance mode."));
+  logging->writeTrace(LOG_MODULE_DRAINAGE, F("HydroMonitorDrainage::drainStart(): Starting manual drainage sequence - into maintenance mode."));
   bitSet(sensorData->systemStatus, STATUS_MAINTENANCE);
   drainageState = DRAINAGE_MANUAL_DRAINING_START;
 }
 
 void HydroMonitorDrainage::drainStop() {
-  logging->writeTrace(F("HydroMonitorDrainage::drainStop(): Stopping manual drainage sequence - back to normal."));
+  logging->writeTrace(LOG_MODULE_DRAINAGE, F("HydroMonitorDrainage::drainStop(): Stopping manual drainage sequence - back to normal."));
   drainageState = DRAINAGE_IDLE;
   bitClear(sensorData->systemStatus, STATUS_MAINTENANCE);
   switchPumpOff();
@@ -387,7 +387,7 @@ void HydroMonitorDrainage::updateSettings(ESP8266WebServer * server) {
    Swich pump on.
 */
 void HydroMonitorDrainage::switchPumpOn() {
-  logging->writeTrace(F("HydroMonitorDrainage: switching on drainage pump."));
+  logging->writeTrace(LOG_MODULE_DRAINAGE, F("HydroMonitorDrainage: switching on drainage pump."));
 #ifdef DRAINAGE_PIN
   digitalWrite(DRAINAGE_PIN, HIGH);
 #elif defined(DRAINAGE_MCP_PIN)
@@ -402,7 +402,7 @@ void HydroMonitorDrainage::switchPumpOn() {
    Swich pump off.
 */
 void HydroMonitorDrainage::switchPumpOff() {
-  logging->writeTrace(F("HydroMonitorDrainage: switching off drainage pump."));
+  logging->writeTrace(LOG_MODULE_DRAINAGE, F("HydroMonitorDrainage: switching off drainage pump."));
 #ifdef DRAINAGE_PIN
   digitalWrite(p, LOW);
 #elif defined(DRAINAGE_MCP_PIN)
@@ -28,7 +28,7 @@ HydroMonitorECSensor::HydroMonitorECSensor () {
 */
 void HydroMonitorECSensor::begin(HydroMonitorCore::SensorData *sd, HydroMonitorLogging *l) {
   logging = l;
-  logging->writeTrace(F("HydroMonitorECSensor: configured EC sensor."));
+  logging->writeTrace(LOG_MODULE_ECSENSOR, F("HydroMonitorECSensor: configured EC sensor."));
   sensorData = sd;
   if (EC_SENSOR_EEPROM > 0)
 #ifdef USE_24LC256_EEPROM
@@ -94,28 +94,20 @@ void HydroMonitorECSensor::readSensor(bool readNow) {
       // Send warning if it's been long enough ago & EC is >30% below target.
       if (millis() - lastWarned > WARNING_INTERVAL && sensorData->EC < 0.7 * sensorData->targetEC) {
         lastWarned = millis();
-        char message[140];
-        sprintf_P(message, PSTR("ECSensor 01: EC level is too low; additional fertiliser is urgently needed. Target set: %2.2f mS/cm, current EC: %2.2f mS/cm."),
-                  sensorData->targetEC, sensorData->EC);
-        logging->writeWarning(message);
+        logging->writeWarning(MESSAGE_ECSENSOR_01, sensorData->targetEC, sensorData->EC);
       }
 
       // Send warning if EC is exceptionally high.
       if (millis() - lastWarned > WARNING_INTERVAL && sensorData->EC > 5) {
         lastWarned = millis();
-        char message[120];
-        sprintf_P(message, PSTR("ECSensor 02: EC level is exceptionally high: %2.2f mS/cm. Check sensor."),
-                  sensorData->EC);
-        logging->writeWarning(message);
+        logging->writeWarning(MESSAGE_ECSENSOR_02, sensorData->EC);
       }
     }
     else {
       sensorData->EC = -1;
       if (millis() - lastWarned > WARNING_INTERVAL) {
         lastWarned = millis();
-        char message[120];
-        sprintf_P(message, PSTR("ECSensor 03: EC sensor not detected."));
-        logging->writeWarning(message);
+        logging->writeWarning(MESSAGE_ECSENSOR_03);
       }
     }
     Serial.println();
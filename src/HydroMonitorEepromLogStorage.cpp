@@ -0,0 +1,32 @@
+#include <HydroMonitorEepromLogStorage.h>
+
+#ifdef USE_24LC256_EEPROM
+
+/*
+   Log segments in a 24LC256 EEPROM.
+*/
+
+/*
+   The constructor: the segments are stored in e, in the size bytes from address s.
+*/
+HydroMonitorEepromLogStorage::HydroMonitorEepromLogStorage(HydroMonitorEepromPages* e, uint16_t s, uint16_t size) :
+  HydroMonitorSlotLogStorage(size) {
+  eeprom = e;
+  start = s;
+}
+
+/*
+   Read n bytes from address (relative to the start of the region).
+*/
+void HydroMonitorEepromLogStorage::readRaw(uint32_t address, uint8_t* data, uint16_t n) {
+  eeprom->read(start + address, data, n);
+}
+
+/*
+   Write n bytes at address (relative to the start of the region). The region starts at a page boundary, so the
+   slots and the slot table entries line up with the pages.
+*/
+void HydroMonitorEepromLogStorage::writeRaw(uint32_t address, const uint8_t* data, uint16_t n) {
+  eeprom->write(start + address, data, n);
+}
+#endif
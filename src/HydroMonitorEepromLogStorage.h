@@ -0,0 +1,53 @@
+/*
+   HydroMonitorEepromLogStorage
+
+   Log segments in a region of the external 24LC256 I2C EEPROM (see HydroMonitorSlotLogStorage). All reads and
+   writes go through HydroMonitorEepromPages: page-aligned chunks of up to 64 bytes, with ACK polling.
+
+   The EEPROM has an endurance of a million write cycles per page, against some ten thousand for a Flash sector,
+   and writes a record without an erase; it holds the hot end of the logs (see HydroMonitorTieredLogStorage).
+
+   Layout of the 24LC256 (32 kB):
+     0 - EEPROM_SIZE: the settings.
+     EEPROM_CURSOR_START: the transmission cursor, a ring of EEPROM_CURSOR_SIZE bytes (see HydroMonitorLogging.h).
+     EEPROM_DATA_TIER_START: the newest data records, two segments.
+     EEPROM_MESSAGE_TIER_START: the newest messages, two segments.
+     EEPROM_BENCHMARK_START: the rest, scratch space for the storage benchmark.
+
+   Only available with USE_24LC256_EEPROM defined.
+
+*/
+
+#ifndef HYDROMONITOREEPROMLOGSTORAGE_H
+#define HYDROMONITOREEPROMLOGSTORAGE_H
+
+#include <HydroMonitorCore.h>
+
+#ifdef USE_24LC256_EEPROM
+#include <HydroMonitorSlotLogStorage.h>
+#include <HydroMonitorEepromPages.h>
+
+const uint16_t EEPROM_CURSOR_START = EEPROM_SIZE;           // Above the settings.
+const uint16_t EEPROM_CURSOR_SIZE = 1024;
+const uint8_t EEPROM_CURSOR_ENTRIES = EEPROM_CURSOR_SIZE / 16; // Entries of the cursor ring, 16 bytes each.
+const uint16_t EEPROM_TIER_SIZE = 2 * LOG_SEGMENT_SIZE + SLOT_TABLE_ALIGN; // Two segments and their slot table.
+const uint16_t EEPROM_DATA_TIER_START = EEPROM_CURSOR_START + EEPROM_CURSOR_SIZE;
+const uint16_t EEPROM_MESSAGE_TIER_START = EEPROM_DATA_TIER_START + EEPROM_TIER_SIZE;
+const uint16_t EEPROM_BENCHMARK_START = EEPROM_MESSAGE_TIER_START + EEPROM_TIER_SIZE;
+const uint16_t EEPROM_BENCHMARK_SIZE = 32768 - EEPROM_BENCHMARK_START; // Up to the end of the 24LC256.
+
+class HydroMonitorEepromLogStorage : public HydroMonitorSlotLogStorage
+{
+  public:
+    HydroMonitorEepromLogStorage(HydroMonitorEepromPages*, uint16_t, uint16_t);
+
+  protected:
+    void readRaw(uint32_t, uint8_t*, uint16_t);
+    void writeRaw(uint32_t, const uint8_t*, uint16_t);
+
+  private:
+    HydroMonitorEepromPages* eeprom;
+    uint16_t start;                                         // First address of the region.
+};
+#endif
+#endif
@@ -0,0 +1,72 @@
+#include <HydroMonitorEepromPages.h>
+
+#ifdef USE_24LC256_EEPROM
+
+/*
+   Page reads and writes of the 24LC256 EEPROM.
+*/
+
+/*
+   The constructor.
+*/
+HydroMonitorEepromPages::HydroMonitorEepromPages() {
+}
+
+/*
+   Read n bytes from address, a page at a time.
+*/
+void HydroMonitorEepromPages::read(uint16_t address, uint8_t* data, uint16_t n) {
+  while (n > 0) {
+    uint8_t chunk = min(n, (uint16_t)EEPROM_PAGE_SIZE);
+    Wire.beginTransmission(EEPROM_I2C_ADDRESS);
+    Wire.write(address >> 8);
+    Wire.write(address & 0xFF);
+    Wire.endTransmission();
+    Wire.requestFrom(EEPROM_I2C_ADDRESS, chunk);
+    for (uint8_t i = 0; i < chunk; i++) {
+      data[i] = (Wire.available()) ? Wire.read() : 0xFF;
+    }
+    address += chunk;
+    data += chunk;
+    n -= chunk;
+  }
+}
+
+/*
+   Write n bytes at address, in chunks that don't cross a page boundary, waiting for each write cycle to complete.
+   Returns false if the chip didn't acknowledge one of the writes.
+*/
+bool HydroMonitorEepromPages::write(uint16_t address, const uint8_t* data, uint16_t n) {
+  bool success = true;
+  while (n > 0) {
+    uint8_t chunk = min(n, (uint16_t)(EEPROM_PAGE_SIZE - address % EEPROM_PAGE_SIZE));
+    Wire.beginTransmission(EEPROM_I2C_ADDRESS);
+    Wire.write(address >> 8);
+    Wire.write(address & 0xFF);
+    Wire.write(data, chunk);
+    Wire.endTransmission();
+    if (waitReady() == false) {
+      success = false;
+    }
+    address += chunk;
+    data += chunk;
+    n -= chunk;
+  }
+  return success;
+}
+
+/*
+   ACK polling: address the chip until it acknowledges, which it does once the write cycle is complete.
+   Returns false if it doesn't within EEPROM_WRITE_TIMEOUT.
+*/
+bool HydroMonitorEepromPages::waitReady() {
+  uint32_t start = millis();
+  do {
+    Wire.beginTransmission(EEPROM_I2C_ADDRESS);
+    if (Wire.endTransmission() == 0) {
+      return true;
+    }
+  } while (millis() - start < EEPROM_WRITE_TIMEOUT);
+  return false;
+}
+#endif
@@ -0,0 +1,43 @@
+/*
+   HydroMonitorEepromPages
+
+   Block reads and writes of the external 24LC256 I2C EEPROM, for the log data kept there.
+
+   The chip is written in pages of EEPROM_PAGE_SIZE bytes: a write of up to a page costs one write cycle (up to
+   5 ms) however many bytes it holds, as long as it doesn't cross a page boundary - the address would wrap around
+   to the start of the page. write() splits the data at the page boundaries, so each chunk is a single page write.
+   After each chunk the chip is ACK polled: it doesn't acknowledge its address until the write cycle is complete,
+   so we wait exactly as long as needed instead of a fixed delay. A chip that doesn't come back within
+   EEPROM_WRITE_TIMEOUT counts as a failed write.
+
+   The settings in the lower part of the chip are read and written by the E24LC256 library; this class doesn't
+   touch those addresses.
+
+   Only available with USE_24LC256_EEPROM defined.
+
+*/
+
+#ifndef HYDROMONITOREEPROMPAGES_H
+#define HYDROMONITOREEPROMPAGES_H
+
+#include <HydroMonitorCore.h>
+
+#ifdef USE_24LC256_EEPROM
+#include <Wire.h>
+
+const uint8_t EEPROM_I2C_ADDRESS = 0x50;                    // I2C address of the 24LC256 (A0-A2 low).
+const uint8_t EEPROM_PAGE_SIZE = 64;                        // Bytes per page write.
+const uint8_t EEPROM_WRITE_TIMEOUT = 10;                    // Longest wait for a write cycle to complete (ms).
+
+class HydroMonitorEepromPages
+{
+  public:
+    HydroMonitorEepromPages();
+    void read(uint16_t, uint8_t*, uint16_t);
+    bool write(uint16_t, const uint8_t*, uint16_t);
+
+  private:
+    bool waitReady();
+};
+#endif
+#endif
@@ -35,7 +35,7 @@ void HydroMonitorFertiliser::begin(HydroMonitorCore::SensorData *sd, HydroMonito
   pumpB = FERTILISER_B_MCP_PIN;
   mcp->pinMode(pumpA, OUTPUT);
   mcp->pinMode(pumpB, OUTPUT);
-  l->writeTrace(F("HydroMonitorFertiliser: set up fertiliser pumps on MCP23008 port expander."));
+  l->writeTrace(LOG_MODULE_FERTILISER, F("HydroMonitorFertiliser: set up fertiliser pumps on MCP23008 port expander."));
 
 #elif defined(FERTILISER_A_MCP17_PIN)
 void HydroMonitorFertiliser::begin(HydroMonitorCore::SensorData * sd, HydroMonitorLogging * l, Adafruit_MCP23017 * mcp23017) {
@@ -44,7 +44,7 @@ void HydroMonitorFertiliser::begin(HydroMonitorCore::SensorData * sd, HydroMonit
   pumpB = FERTILISER_B_MCP17_PIN;
   mcp->pinMode(pumpA, OUTPUT);
   mcp->pinMode(pumpB, OUTPUT);
-  l->writeTrace(F("HydroMonitorFertiliser: set up fertiliser pumps on MCP23017 port expander."));
+  l->writeTrace(LOG_MODULE_FERTILISER, F("HydroMonitorFertiliser: set up fertiliser pumps on MCP23017 port expander."));
 
 #elif defined(FERTILISER_A_PCF_PIN)
 void HydroMonitorFertiliser::begin(HydroMonitorCore::SensorData * sd, HydroMonitorLogging * l, PCF857x * pcf) {
@@ -53,7 +53,7 @@ void HydroMonitorFertiliser::begin(HydroMonitorCore::SensorData * sd, HydroMonit
   pumpB = FERTILISER_B_PCF_PIN;
   pcf8574->pinMode(pumpA, OUTPUT);
   pcf8574->pinMode(pumpB, OUTPUT);
-  l->writeTrace(F("HydroMonitorFertiliser: set up fertiliser pumps on PCF8574 port expander."));
+  l->writeTrace(LOG_MODULE_FERTILISER, F("HydroMonitorFertiliser: set up fertiliser pumps on PCF8574 port expander."));
 
 #elif defined(FERTILISER_A_PIN)
 void HydroMonitorFertiliser::begin(HydroMonitorCore::SensorData * sd, HydroMonitorLogging * l) {
@@ -61,7 +61,7 @@ void HydroMonitorFertiliser::begin(HydroMonitorCore::SensorData * sd, HydroMonit
   pumpB = FERTILISER_B_PIN;
   pinMode(pumpA, OUTPUT);
   pinMode(pumpB, OUTPUT);
-  l->writeTrace(F("HydroMonitorFertiliser: set up fertiliser pumps with direct port connection."));
+  l->writeTrace(LOG_MODULE_FERTILISER, F("HydroMonitorFertiliser: set up fertiliser pumps with direct port connection."));
 #endif
 
   sensorData = sd;
@@ -77,7 +77,7 @@ void HydroMonitorFertiliser::begin(HydroMonitorCore::SensorData * sd, HydroMonit
 
   // Check whether any settings have been set, if not apply defaults.
   if (settings.pumpASpeed < 1 || settings.pumpASpeed > 500) {
-    logging->writeTrace(F("HydroMonitorFertiliser: applying default settings."));
+    logging->writeTrace(LOG_MODULE_FERTILISER, F("HydroMonitorFertiliser: applying default settings."));
     settings.pumpASpeed = 100;
     settings.pumpBSpeed = 100;
 #ifdef USE_24LC256_EEPROM
@@ -112,14 +112,14 @@ void HydroMonitorFertiliser::doFertiliser() {
   if (measuring) {
     if (aRunning) {
       if (millis() - runATime > 60 * 1000ul) {
-        logging->writeTrace(F("HydroMonitorFertiliser: measuring pump A finished."));
+        logging->writeTrace(LOG_MODULE_FERTILISER, F("HydroMonitorFertiliser: measuring pump A finished."));
         switchPumpOff(pumpA);
         measuring = false;
         aRunning = false;
       }
     }
     else if (millis() - runBTime > 60 * 1000ul) {
-      logging->writeTrace(F("HydroMonitorFertiliser: measuring pump B finished."));
+      logging->writeTrace(LOG_MODULE_FERTILISER, F("HydroMonitorFertiliser: measuring pump B finished."));
       switchPumpOff(pumpB);
       measuring = false;
       bRunning = false;
@@ -151,7 +151,7 @@ void HydroMonitorFertiliser::doFertiliser() {
 
   // It's best to start with B first, and do A second.
   else if (addB) {                                          // Add solution B, if needed.
-    logging->writeTrace(F("HydroMonitorFertiliser: start adding solution B, switching pump B on."));
+    logging->writeTrace(LOG_MODULE_FERTILISER, F("HydroMonitorFertiliser: start adding solution B, switching pump B on."));
     switchPumpOn(pumpB);                                    // Switch on the pump,
     bRunning = true;                                        // and flag it's running.
     addB = false;                                           // Reset this flag, as we're adding B now.
@@ -160,7 +160,7 @@ void HydroMonitorFertiliser::doFertiliser() {
 
   // Check whether B is running, and if so whether it's time to stop.
   else if (bRunning && millis() - startTime > runBTime) {
-    logging->writeTrace(F("HydroMonitorFertiliser: finished adding solution B, switching pump B off."));
+    logging->writeTrace(LOG_MODULE_FERTILISER, F("HydroMonitorFertiliser: finished adding solution B, switching pump B off."));
     switchPumpOff(pumpB);                                   // Switch off the pump.
     startATime = millis();                                  // Record when we did this, after a short delay A may start.
     bRunning = false;                                       // Reset the running flag.
@@ -168,7 +168,7 @@ void HydroMonitorFertiliser::doFertiliser() {
 
   // Start adding A if needed and B is not running and the 500 ms break is over.
   else if (addA && !bRunning && millis() - startATime > 500) {
-    logging->writeTrace(F("HydroMonitorFertiliser: start adding solution A, switching pump A on."));
+    logging->writeTrace(LOG_MODULE_FERTILISER, F("HydroMonitorFertiliser: start adding solution A, switching pump A on."));
     switchPumpOn(pumpA);                                    // Switch on the pump,
     aRunning = true;                                        // and flag it's running.
     addA = false;                                           // Reset this flag, as we're adding A now.
@@ -177,7 +177,7 @@ void HydroMonitorFertiliser::doFertiliser() {
 
   // Check whether A is running, and if so whether it's time to stop.
   else if (aRunning && millis() - startTime > runATime) {
-    logging->writeTrace(F("HydroMonitorFertiliser: finished adding solution A, switching pump A off."));
+    logging->writeTrace(LOG_MODULE_FERTILISER, F("HydroMonitorFertiliser: finished adding solution A, switching pump A off."));
     switchPumpOff(pumpA);                                   // Switch off the pump.
     aRunning = false;                                       // Reset the running flag.
     lastTimeAdded = millis();                               // Keep track of when we were done, in order to enforce the 30-minute delay.
@@ -204,14 +204,18 @@ void HydroMonitorFertiliser::doFertiliser() {
     if (sensorData->targetEC - sensorData->EC < 1) {        // If the required increase in EC is less than 1 mS/cm,
       addVolume *= (sensorData->targetEC - sensorData->EC); // correct addVolume accordingly.
     }
-    logging->writeTrace(F("HydroMonitorFertiliser: 10 minutes of too low EC; have to start adding fertiliser."));
+    logging->writeTrace(LOG_MODULE_FERTILISER, F("HydroMonitorFertiliser: 10 minutes of too low EC; have to start adding fertiliser."));
     char buff[100];
-    sprintf_P(buff, PSTR("HydroMonitorFertiliser: adding %3.1f ml of fertiliser solution."), addVolume);
-    logging->writeInfo(buff);
+    if (logging->isLogged(LOG_MODULE_FERTILISER, LOG_INFO)) {
+      sprintf_P(buff, PSTR("HydroMonitorFertiliser: adding %3.1f ml of fertiliser solution."), addVolume);
+      logging->writeInfo(LOG_MODULE_FERTILISER, buff);
+    }
     runATime = addVolume / settings.pumpASpeed * 60 * 1000ul; // the time in milliseconds pump A has to run.
     runBTime = addVolume / settings.pumpBSpeed * 60 * 1000ul; // the time in milliseconds pump B has to run.
-    sprintf_P(buff, PSTR("HydroMonitorFertiliser: going to run pump A for %lu ms and pump B for %lu ms."), runATime, runBTime);
-    logging->writeTrace(buff);
+    if (logging->isLogged(LOG_MODULE_FERTILISER, LOG_TRACE)) {
+      sprintf_P(buff, PSTR("HydroMonitorFertiliser: going to run pump A for %lu ms and pump B for %lu ms."), runATime, runBTime);
+      logging->writeTrace(LOG_MODULE_FERTILISER, buff);
+    }
     lastTimeAdded = millis();                               // Time we last added any fertiliser - which is what we're going to do now.
     originalEC = sensorData->EC;                            // Try to detect whether the EC really came up as expected.
   }
@@ -220,8 +224,8 @@ void HydroMonitorFertiliser::doFertiliser() {
   // Start draining the reservoir after ten minutes of continuously too high EC.
   else if (sensorData->EC > (sensorData->targetEC + 0.2) &&
            millis() - lastGoodEC > 10 * 60 * 1000ul) {
-    logging->writeTrace(F("HydroMonitorFertiliser: 10 minutes of too high EC; completely refresh the reservoir."));
-    logging->writeInfo(F("HydroMonitorFertiliser: refreshing reservoir to be able to reduce the EC value."));
+    logging->writeTrace(LOG_MODULE_FERTILISER, F("HydroMonitorFertiliser: 10 minutes of too high EC; completely refresh the reservoir."));
+    logging->writeInfo(LOG_MODULE_FERTILISER, F("HydroMonitorFertiliser: refreshing reservoir to be able to reduce the EC value."));
     bitSet(sensorData->systemStatus, STATUS_DRAINAGE_NEEDED);
   }
 #endif
@@ -234,7 +238,7 @@ void HydroMonitorFertiliser::doFertiliser() {
       }
     }
     else if (originalEC > 0 && millis() - lastWarned > WARNING_INTERVAL) {
-      logging->writeWarning(F("Fertiliser 01: fertiliser did not go up as expected after running the pumps. Fertiliser bottles may be empty."));
+      logging->writeWarning(MESSAGE_FERTILISER_01);
       lastWarned = millis();
     }
   }
@@ -244,6 +248,7 @@ void HydroMonitorFertiliser::doFertiliser() {
    Swich pump p on.
 */
 void HydroMonitorFertiliser::switchPumpOn(uint8_t p) {
+  bitSet(sensorData->systemStatus, STATUS_DOSING_FERTILISER);
 #ifdef FERTILISER_A_PIN
   digitalWrite(p, HIGH);
 #elif defined(FERTILISER_A_PCF_PIN)
@@ -257,6 +262,7 @@ void HydroMonitorFertiliser::switchPumpOn(uint8_t p) {
    Swich pump p off.
 */
 void HydroMonitorFertiliser::switchPumpOff(uint8_t p) {
+  bitClear(sensorData->systemStatus, STATUS_DOSING_FERTILISER);
 #ifdef FERTILISER_A_PIN
   digitalWrite(p, LOW);
 #elif defined(FERTILISER_A_PCF_PIN)
@@ -272,7 +278,7 @@ void HydroMonitorFertiliser::switchPumpOff(uint8_t p) {
 */
 void HydroMonitorFertiliser::measurePumpA() {
   if (!(aRunning || bRunning)) {
-    logging->writeTrace(F("HydroMonitorFertiliser: switching on pump A."));
+    logging->writeTrace(LOG_MODULE_FERTILISER, F("HydroMonitorFertiliser: switching on pump A."));
     switchPumpOn(pumpA);
     runATime = millis();
     aRunning = true;
@@ -285,7 +291,7 @@ void HydroMonitorFertiliser::measurePumpA() {
 */
 void HydroMonitorFertiliser::measurePumpB() {
   if ( !(aRunning || bRunning)) {
-    logging->writeTrace(F("HydroMonitorFertiliser: switching on pump B."));
+    logging->writeTrace(LOG_MODULE_FERTILISER, F("HydroMonitorFertiliser: switching on pump B."));
     switchPumpOn(pumpB);
     runBTime = millis();
     bRunning = true;
@@ -360,7 +366,7 @@ void HydroMonitorFertiliser::updateSettings(ESP8266WebServer * server) {
   EEPROM.put(FERTILISER_EEPROM, settings);
   EEPROM.commit();
 #endif
-  logging->writeTrace(F("HydroMonitorFertiliser: updated settings."));
+  logging->writeTrace(LOG_MODULE_FERTILISER, F("HydroMonitorFertiliser: updated settings."));
 }
 
 #endif
@@ -0,0 +1,142 @@
+#include <HydroMonitorFileLogStorage.h>
+
+/*
+   Log segments as files in SPIFFS or LittleFS.
+*/
+
+/*
+   The constructor: the segments are stored in file system fs.
+*/
+HydroMonitorFileLogStorage::HydroMonitorFileLogStorage(fs::FS* fs) {
+  fileSystem = fs;
+}
+
+/*
+   dir: the directory holding the segment files, including the trailing slash.
+*/
+void HydroMonitorFileLogStorage::begin(const char* dir) {
+  directory = dir;
+  ownSize = 0;
+  readerSegment = 0xFFFFFFFF;
+}
+
+/*
+   List the segment files: the next one each call, or with restart set the first one again.
+   Returns false if there are no more.
+*/
+bool HydroMonitorFileLogStorage::nextSegment(bool restart, uint32_t* segment, uint16_t* length) {
+  if (restart) {
+    dir = fileSystem->openDir(directory);
+    ownSize = 0;
+  }
+  if (dir.next() == false) {
+    return false;
+  }
+  String name = dir.fileName();
+  *segment = atol(name.c_str() + name.lastIndexOf('/') + 1);
+  *length = dir.fileSize();
+  ownSize += *length;
+  return true;
+}
+
+/*
+   The space the store may use: share percent of the free space, including the segments listed by nextSegment().
+*/
+uint32_t HydroMonitorFileLogStorage::capacity(uint8_t share) {
+  return (freeSpace() + ownSize) / 100 * share;
+}
+
+/*
+   Whether the store may keep more segments than its capacity allows: there's enough space left for everything else.
+*/
+bool HydroMonitorFileLogStorage::canGrow() {
+  return freeSpace() > LOG_RESERVED_SPACE;
+}
+
+/*
+   Append size bytes to the end of segment; a new segment file is created if needed.
+   Returns false if not all bytes could be written.
+*/
+bool HydroMonitorFileLogStorage::append(uint32_t segment, const uint8_t* data, uint16_t size) {
+  if (head && headSegment != segment) {
+    head.close();
+  }
+  if (!head) {
+    char name[16];
+    segmentName(name, segment);
+    head = fileSystem->open(name, "a");
+    headSegment = segment;
+  }
+  uint16_t n = head.write(data, size);
+  head.flush();                                             // Make the record visible to readers.
+  bytesWritten += n;
+  return n == size;
+}
+
+/*
+   Read up to size bytes from segment, starting at offset.
+   Returns the number of bytes read.
+*/
+uint16_t HydroMonitorFileLogStorage::read(uint32_t segment, uint16_t offset, uint8_t* buffer, uint16_t size) {
+  if (reader && readerSegment == segment && head && headSegment == segment && offset + size > reader.size()) {
+    reader.close();                                         // The head segment grew: open it again to see the new records.
+  }
+  if (!reader || readerSegment != segment) {
+    reader.close();
+    char name[16];
+    segmentName(name, segment);
+    reader = fileSystem->open(name, "r");
+    readerSegment = segment;
+    if (!reader) {
+      return 0;
+    }
+  }
+  if (reader.position() != offset) {
+    reader.seek(offset, SeekSet);
+  }
+  return reader.read(buffer, size);
+}
+
+/*
+   Cut segment off after length bytes.
+*/
+void HydroMonitorFileLogStorage::cut(uint32_t segment, uint16_t length) {
+  head.close();
+  reader.close();
+  char name[16];
+  segmentName(name, segment);
+  File f = fileSystem->open(name, "r+");
+  f.truncate(length);
+  f.close();
+}
+
+/*
+   Remove segment.
+*/
+void HydroMonitorFileLogStorage::remove(uint32_t segment) {
+  if (readerSegment == segment) {
+    reader.close();
+  }
+  if (head && headSegment == segment) {
+    head.close();
+  }
+  char name[16];
+  segmentName(name, segment);
+  fileSystem->remove(name);
+}
+
+/*
+   The file name of a segment.
+*/
+void HydroMonitorFileLogStorage::segmentName(char* name, uint32_t segment) {
+  sprintf_P(name, PSTR("%s%u"), directory, segment);
+}
+
+/*
+   Free space in the file system (bytes).
+*/
+uint32_t HydroMonitorFileLogStorage::freeSpace() {
+  FSInfo info;
+  fileSystem->info(info);
+  return info.totalBytes - info.usedBytes;
+}
@@ -0,0 +1,52 @@
+/*
+   HydroMonitorFileLogStorage
+
+   Log segments as files in a file system: SPIFFS, or LittleFS - anything with the fs::FS interface of the
+   ESP8266 core. The file system must be mounted by the caller; SPIFFS and LittleFS use the same Flash partition,
+   so only one of them can be used at a time.
+
+   Segment files are named <directory><segment number>, e.g. /dl/12.
+
+   The head segment file is kept open for appending, and each record is written with a single write call. The
+   latest segment read is kept open as well, so reading the records of a segment one after another doesn't open
+   the file for every read.
+
+   The space a store may use is its share of the free space of the file system, plus what it uses already. A
+   store may grow over the number of segments it keeps as long as LOG_RESERVED_SPACE is left free.
+
+*/
+
+#ifndef HYDROMONITORFILELOGSTORAGE_H
+#define HYDROMONITORFILELOGSTORAGE_H
+
+#include <HydroMonitorLogStorage.h>
+
+const uint32_t LOG_RESERVED_SPACE = 32768;                  // Free space to leave in the file system for everything else.
+
+class HydroMonitorFileLogStorage : public HydroMonitorLogStorage
+{
+  public:
+    HydroMonitorFileLogStorage(fs::FS*);
+    void begin(const char*);
+    bool nextSegment(bool, uint32_t*, uint16_t*);
+    uint32_t capacity(uint8_t);
+    bool canGrow();
+    bool append(uint32_t, const uint8_t*, uint16_t);
+    uint16_t read(uint32_t, uint16_t, uint8_t*, uint16_t);
+    void cut(uint32_t, uint16_t);
+    void remove(uint32_t);
+
+  private:
+    void segmentName(char*, uint32_t);
+    uint32_t freeSpace();
+
+    fs::FS* fileSystem;
+    const char* directory;
+    Dir dir;                                                // Listing the segments.
+    uint32_t ownSize;                                       // Size of the segments listed.
+    File head;                                              // The head segment, open for appending.
+    uint32_t headSegment;
+    File reader;                                            // The segment read last.
+    uint32_t readerSegment;
+};
+#endif
@@ -22,7 +22,7 @@ void ICACHE_RAM_ATTR HydroMonitorFlowSensor::countPulse() {
 */
 void HydroMonitorFlowSensor::begin(HydroMonitorCore::SensorData *sd, HydroMonitorLogging *l) {
   logging = l;
-  logging->writeTrace(F("HydroMonitorFlowSensor: configured flow sensor."));
+  logging->writeTrace(LOG_MODULE_FLOWSENSOR, F("HydroMonitorFlowSensor: configured flow sensor."));
   sensorData = sd;
   sensorData->flow = -1; // Default: no sensor detected yet.
 
@@ -21,7 +21,7 @@ void HydroMonitorGrowingParameters::begin(HydroMonitorCore::SensorData *sd, Hydr
 
   // Check whether any settings have been set, if not apply defaults.
   if (settings.fertiliserConcentration > 500) {
-    logging->writeTrace(F("HydroMonitorGrowingParameters: applying default settings."));
+    logging->writeTrace(LOG_MODULE_GROWINGPARAMETERS, F("HydroMonitorGrowingParameters: applying default settings."));
     settings.fertiliserConcentration = 200;
     settings.solutionVolume = 100;
     settings.targetEC = 1;
@@ -37,7 +37,7 @@ void HydroMonitorGrowingParameters::begin(HydroMonitorCore::SensorData *sd, Hydr
 #endif
   }
   updateSensorData();
-  logging->writeInfo(F("HydroMonitorGrowingParameters: set up all the growing parameters."));
+  logging->writeInfo(LOG_MODULE_GROWINGPARAMETERS, F("HydroMonitorGrowingParameters: set up all the growing parameters."));
 }
 
 /*
@@ -195,7 +195,7 @@ void HydroMonitorGrowingParameters::updateSettings(ESP8266WebServer* server) {
   EEPROM.commit();
 #endif
   updateSensorData();
-  logging->writeTrace(F("HydroMonitorGrowingParameters: updated settings."));
+  logging->writeTrace(LOG_MODULE_GROWINGPARAMETERS, F("HydroMonitorGrowingParameters: updated settings."));
 }
 
 /*
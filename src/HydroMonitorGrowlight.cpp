@@ -13,7 +13,7 @@ HydroMonitorGrowlight::HydroMonitorGrowlight (void) {
 #ifdef GROWLIGHT_PCF_PIN
 void HydroMonitorGrowlight::begin(HydroMonitorCore::SensorData *sd, HydroMonitorLogging *l, PCF857x *pcf) {
   pcf8574 = pcf;
-  l->writeTrace(F("HydroMonitorGrowlight: set up growing light on PCF port expander."));
+  l->writeTrace(LOG_MODULE_GROWLIGHT, F("HydroMonitorGrowlight: set up growing light on PCF port expander."));
 
   /*
      Set up the module - growing light connected to the MCP23008 port expander.
@@ -22,7 +22,7 @@ void HydroMonitorGrowlight::begin(HydroMonitorCore::SensorData *sd, HydroMonitor
 void HydroMonitorGrowlight::begin(HydroMonitorCore::SensorData * sd, HydroMonitorLogging * l, Adafruit_MCP23008 * mcp) {
   mcp23008 = mcp;
   mcp23008->pinMode(GROWLIGHT_MCP_PIN, OUTPUT);
-  l->writeTrace(F("HydroMonitorGrowlight: set up growing light on MCP port expander."));
+  l->writeTrace(LOG_MODULE_GROWLIGHT, F("HydroMonitorGrowlight: set up growing light on MCP port expander."));
 
   /*
      Set up the module - growing light connected to the MCP23017 port expander.
@@ -31,7 +31,7 @@ void HydroMonitorGrowlight::begin(HydroMonitorCore::SensorData * sd, HydroMonito
 void HydroMonitorGrowlight::begin(HydroMonitorCore::SensorData * sd, HydroMonitorLogging * l, Adafruit_MCP23017 * mcp) {
   mcp23017 = mcp;
   mcp23017->pinMode(GROWLIGHT_MCP17_PIN, OUTPUT);
-  l->writeTrace(F("HydroMonitorGrowlight: set up growing light on MCP17 port expander."));
+  l->writeTrace(LOG_MODULE_GROWLIGHT, F("HydroMonitorGrowlight: set up growing light on MCP17 port expander."));
 
   /*
      Set up the module - growing light connected to a GPIO pin.
@@ -39,7 +39,7 @@ void HydroMonitorGrowlight::begin(HydroMonitorCore::SensorData * sd, HydroMonito
 #elif defined(GROWLIGHT_PIN)
 void HydroMonitorGrowlight::begin(HydroMonitorCore::SensorData * sd, HydroMonitorLogging * l) {
   pinMode(GROWLIGHT_PIN, OUTPUT);
-  l->writeTrace(F("HydroMonitorGrowlight: set up growing light."));
+  l->writeTrace(LOG_MODULE_GROWLIGHT, F("HydroMonitorGrowlight: set up growing light."));
 #endif
 
   sensorData = sd;
@@ -51,7 +51,7 @@ void HydroMonitorGrowlight::begin(HydroMonitorCore::SensorData * sd, HydroMonito
   // Check whether we have a sensible value for switchBrightness; if not
   // set defaults for all settings.
   if (settings.switchBrightness == 0 || settings.switchBrightness == 65535) {
-    logging->writeTrace(F("HydroMonitorGrowlight: applying default settings."));
+    logging->writeTrace(LOG_MODULE_GROWLIGHT, F("HydroMonitorGrowlight: applying default settings."));
     settings.switchBrightness = 1000;                       // Brightness below which the light may be switched on.
     settings.switchDelay = 5 * 60;                          // The delay in seconds.
     settings.onHour = 6;                                    // Hour and
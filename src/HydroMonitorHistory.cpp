@@ -0,0 +1,65 @@
+#include <HydroMonitorHistory.h>
+
+/*
+   RAM ring of the sensor data of the last 24 hours.
+*/
+
+/*
+   The constructor.
+*/
+HydroMonitorHistory::HydroMonitorHistory() {
+  values = NULL;
+  channels = 0;
+  first = 0;
+  nSamples = 0;
+}
+
+/*
+   Allocate the history for c channels.
+*/
+void HydroMonitorHistory::begin(uint8_t c) {
+  delete[] values;
+  channels = c;
+  values = new uint16_t[HISTORY_SAMPLES * channels];
+  first = 0;
+  nSamples = 0;
+}
+
+/*
+   Add a sample: the value of each channel, taken at timestamp.
+*/
+void HydroMonitorHistory::add(uint32_t timestamp, const uint16_t* sample) {
+  if (values == NULL) {
+    return;
+  }
+  uint8_t i = (first + nSamples) % HISTORY_SAMPLES;
+  if (nSamples == HISTORY_SAMPLES) {                        // Full: drop the oldest.
+    first = (first + 1) % HISTORY_SAMPLES;
+  }
+  else {
+    nSamples++;
+  }
+  timestamps[i] = timestamp;
+  memcpy(values + i * channels, sample, channels * sizeof(uint16_t));
+}
+
+/*
+   Number of samples held.
+*/
+uint8_t HydroMonitorHistory::count() {
+  return nSamples;
+}
+
+/*
+   Time stamp of sample i (0 = the oldest).
+*/
+uint32_t HydroMonitorHistory::timestamp(uint8_t i) {
+  return timestamps[(first + i) % HISTORY_SAMPLES];
+}
+
+/*
+   Value of channel c in sample i (0 = the oldest).
+*/
+uint16_t HydroMonitorHistory::value(uint8_t i, uint8_t c) {
+  return values[((first + i) % HISTORY_SAMPLES) * channels + c];
+}
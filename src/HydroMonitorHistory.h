@@ -0,0 +1,38 @@
+/*
+   HydroMonitorHistory
+
+   The sensor data of the last 24 hours, kept in RAM for the dashboard charts: HISTORY_SAMPLES samples, one every
+   REFRESH_DATABASE, each with its time stamp and a 16-bit value per channel. The samples are a ring: adding one
+   drops the oldest when the history is full.
+
+   The history doesn't know what the channels are: the caller quantizes the values (see historyJSON() in
+   HydroMonitorLogging.cpp). The values are allocated in begin(), for the number of channels the board logs.
+   Nothing survives a restart.
+
+*/
+
+#ifndef HYDROMONITORHISTORY_H
+#define HYDROMONITORHISTORY_H
+
+#include <Arduino.h>
+
+const uint8_t HISTORY_SAMPLES = 144;                        // 24 hours of 10-minute samples.
+
+class HydroMonitorHistory
+{
+  public:
+    HydroMonitorHistory();
+    void begin(uint8_t);
+    void add(uint32_t, const uint16_t*);
+    uint8_t count();
+    uint32_t timestamp(uint8_t);
+    uint16_t value(uint8_t, uint8_t);
+
+  private:
+    uint16_t* values;                                       // Per sample, the value of each channel.
+    uint32_t timestamps[HISTORY_SAMPLES];
+    uint8_t channels;
+    uint8_t first;                                          // Index of the oldest sample.
+    uint8_t nSamples;
+};
+#endif
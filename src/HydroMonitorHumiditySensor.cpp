@@ -16,7 +16,7 @@ HydroMonitorHumiditySensor::HydroMonitorHumiditySensor () {
 #ifdef USE_DHT22
 void HydroMonitorHumiditySensor::begin(HydroMonitorCore::SensorData *sd, HydroMonitorLogging *l, DHT22 *dht) {
   dht22 = dht;
-  l->writeInfo(F("HydroMonitorHumiditySensor: configured DHT22 sensor."));
+  l->writeInfo(LOG_MODULE_HUMIDITYSENSOR, F("HydroMonitorHumiditySensor: configured DHT22 sensor."));
 #endif
 
 /*
@@ -25,7 +25,7 @@ void HydroMonitorHumiditySensor::begin(HydroMonitorCore::SensorData *sd, HydroMo
 #ifdef USE_BME280
 void HydroMonitorHumiditySensor::begin(HydroMonitorCore::SensorData * sd, HydroMonitorLogging * l, BME280 * bme) {
   bme280 = bme;
-  l->writeInfo(F("HydroMonitorHumiditySensor: configured BME280 sensor."));
+  l->writeInfo(LOG_MODULE_HUMIDITYSENSOR, F("HydroMonitorHumiditySensor: configured BME280 sensor."));
 #endif
   sensorData = sd;
   logging = l;
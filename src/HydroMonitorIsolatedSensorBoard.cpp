@@ -10,7 +10,7 @@ HydroMonitorIsolatedSensorBoard::HydroMonitorIsolatedSensorBoard () {
 */
 void HydroMonitorIsolatedSensorBoard::begin(HydroMonitorCore::SensorData *sd, HydroMonitorLogging *l, SoftwareSerial *s) {
   logging = l;
-  logging->writeTrace(F("HydroMonitorIsolatedSensorBoard: configured isolated sensor board."));
+  logging->writeTrace(LOG_MODULE_ISOLATEDSENSORBOARD, F("HydroMonitorIsolatedSensorBoard: configured isolated sensor board."));
   sensorData = sd;
   sensorSerial = s;
   if (ISOLATED_SENSOR_BOARD_EEPROM > 0) {
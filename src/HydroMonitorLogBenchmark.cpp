@@ -0,0 +1,62 @@
+#include <HydroMonitorLogBenchmark.h>
+
+/*
+   Benchmark of a log storage.
+*/
+
+/*
+   The constructor.
+*/
+HydroMonitorLogBenchmark::HydroMonitorLogBenchmark() {
+}
+
+/*
+   Run the benchmark.
+
+   storage: the storage to measure.
+   dir: the scratch directory of the store, including the trailing slash; it should not be used by anything else.
+   recordSize: the size of the records to append (bytes).
+   result: the measurements.
+*/
+void HydroMonitorLogBenchmark::run(HydroMonitorLogStorage* storage, const char* dir, uint16_t recordSize, Result* result) {
+  HydroMonitorLogStore store;
+  store.begin(storage, dir, BENCHMARK_SHARE);
+  store.truncate(store.end());                              // Left-overs of an earlier run may go.
+  uint32_t startBytes = storage->bytesWritten;
+  uint8_t record[recordSize];
+  uint32_t totalTime = 0;
+  uint32_t totalRolloverTime = 0;
+  result->records = BENCHMARK_SEGMENTS * (LOG_SEGMENT_SIZE / recordSize);
+  result->maxAppendTime = 0;
+  result->rollovers = 0;
+  result->failed = false;
+  for (uint32_t i = 0; i < result->records; i++) {
+    for (uint16_t j = 0; j < recordSize; j++) {
+      record[j] = i + j;
+    }
+    uint32_t headStart = store.headStart();
+    uint32_t bytes = storage->bytesWritten;
+    uint32_t start = micros();
+    uint32_t position = store.append(record, recordSize);
+    uint32_t appendTime = micros() - start;
+    if (storage->bytesWritten - bytes < recordSize) {
+      result->failed = true;
+    }
+    totalTime += appendTime;
+    result->maxAppendTime = max(result->maxAppendTime, appendTime);
+    if (store.headStart() != headStart && i > 0) {          // This record started a new segment.
+      result->rollovers++;
+      totalRolloverTime += appendTime;
+    }
+    store.truncate(position);                               // Old segments may be removed as the store fills up.
+    yield();
+  }
+  result->appendTime = totalTime / result->records;
+  result->rolloverTime = (result->rollovers > 0) ? totalRolloverTime / result->rollovers : 0;
+  result->bytesWritten = storage->bytesWritten - startBytes;
+
+  // Clean up.
+  for (uint32_t segment = store.first() / LOG_SEGMENT_SIZE; segment <= store.headStart() / LOG_SEGMENT_SIZE; segment++) {
+    storage->remove(segment);
+  }
+}
@@ -0,0 +1,47 @@
+/*
+   HydroMonitorLogBenchmark
+
+   Measures what appending records costs on a log storage (see HydroMonitorLogStorage.h), so the storages can be
+   compared on the device itself:
+   - append latency: the average and the longest time to append a record (us);
+   - rollover cost: the average time of the appends that start a new segment, and that remove the oldest one when
+     the store is full (us);
+   - bytes written per record: everything the storage writes to its medium, divided by the number of records.
+
+   A benchmark runs a fresh store in its own directory on the storage, appends records of the given size until
+   some segments have been filled, and removes all segments again. The record contents don't matter to any of the
+   storages, so the records are filled with a counter.
+
+   Only the file system that is mounted can be measured: SPIFFS and LittleFS use the same Flash partition. To
+   compare the two, build once with and once without LOG_LITTLEFS (see HydroMonitorLogging.h).
+
+   A run blocks until it's done: a few seconds per storage, with a flush or an EEPROM page write for every record.
+   It's for testing only: HydroMonitorLogging has it only when STORAGE_TEST_BENCHMARK is defined.
+
+*/
+
+#ifndef HYDROMONITORLOGBENCHMARK_H
+#define HYDROMONITORLOGBENCHMARK_H
+
+#include <HydroMonitorLogStore.h>
+
+const uint8_t BENCHMARK_SEGMENTS = 3;                       // Segments filled by a benchmark run.
+const uint8_t BENCHMARK_SHARE = 5;                          // Share of the free space for the benchmark store (%).
+
+class HydroMonitorLogBenchmark
+{
+  public:
+    struct Result {
+      uint32_t records;                                     // Records appended.
+      uint32_t appendTime;                                  // Average time of an append (us).
+      uint32_t maxAppendTime;                               // Longest append (us).
+      uint16_t rollovers;                                   // Appends that started a new segment.
+      uint32_t rolloverTime;                                // Average time of those appends (us).
+      uint32_t bytesWritten;                                // Bytes written to the medium.
+      bool failed;                                          // An append didn't make it to the medium.
+    };
+
+    HydroMonitorLogBenchmark();
+    void run(HydroMonitorLogStorage*, const char*, uint16_t, Result*);
+};
+#endif
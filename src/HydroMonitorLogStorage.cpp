@@ -0,0 +1,85 @@
+#include <HydroMonitorLogStorage.h>
+
+/*
+   Reading a log segment through its storage.
+*/
+
+/*
+   A file that is not open.
+*/
+HydroMonitorLogFile::HydroMonitorLogFile() {
+  storage = NULL;
+  segment = 0;
+  offset = 0;
+  length = 0;
+}
+
+/*
+   Segment s of storage st, of l bytes, with the read position at o.
+*/
+HydroMonitorLogFile::HydroMonitorLogFile(HydroMonitorLogStorage* st, uint32_t s, uint16_t o, uint16_t l) {
+  storage = st;
+  segment = s;
+  offset = o;
+  length = l;
+}
+
+/*
+   Read up to size bytes into buffer.
+   Returns the number of bytes read.
+*/
+size_t HydroMonitorLogFile::read(uint8_t* buffer, size_t size) {
+  if (storage == NULL) {
+    return 0;
+  }
+  uint16_t n = storage->read(segment, offset, buffer, size);
+  offset += n;
+  return n;
+}
+
+size_t HydroMonitorLogFile::readBytes(char* buffer, size_t size) {
+  return read((uint8_t*)buffer, size);
+}
+
+/*
+   Read up to size bytes into buffer, until terminator. The terminator is read, but not stored.
+   Returns the number of bytes stored.
+*/
+size_t HydroMonitorLogFile::readBytesUntil(char terminator, char* buffer, size_t size) {
+  size_t n = 0;
+  char c;
+  while (n < size && read((uint8_t*)&c, 1) == 1 && c != terminator) {
+    buffer[n++] = c;
+  }
+  return n;
+}
+
+/*
+   Set the read position. Like File::seek(), but only SeekSet and SeekCur are supported.
+*/
+bool HydroMonitorLogFile::seek(uint32_t position, SeekMode mode) {
+  if (storage == NULL) {
+    return false;
+  }
+  offset = (mode == SeekCur) ? offset + position : position;
+  return offset <= length;
+}
+
+size_t HydroMonitorLogFile::position() {
+  return offset;
+}
+
+/*
+   Length of the segment when it was opened.
+*/
+size_t HydroMonitorLogFile::size() {
+  return length;
+}
+
+void HydroMonitorLogFile::close() {
+  storage = NULL;
+}
+
+HydroMonitorLogFile::operator bool() const {
+  return storage != NULL;
+}
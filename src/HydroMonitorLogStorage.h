@@ -0,0 +1,61 @@
+/*
+   HydroMonitorLogStorage
+
+   The interface between a HydroMonitorLogStore and the medium its segments are kept on. The store does the
+   bookkeeping - which segments there are, how long they are, which may be removed - and the storage only keeps
+   the bytes: append to a segment, read from it, cut it short, remove it, and list what's there at startup.
+   Each store has its own storage object; the storage may keep state for it, like the open head segment file.
+
+   Implementations:
+   - HydroMonitorFileLogStorage: segment files in a file system, SPIFFS or LittleFS.
+   - HydroMonitorRamLogStorage: segments in a RAM buffer; nothing survives a reset. Runs anywhere, also on a host.
+   - HydroMonitorEepromLogStorage: segments in an external 24LC256 I2C EEPROM.
+
+   bytesWritten counts the bytes written to the medium for the records, plus whatever the storage writes to keep
+   track of them (like the slot table of the EEPROM), so storages can be compared (see HydroMonitorLogBenchmark).
+
+   HydroMonitorLogFile reads a segment through its storage. It has the part of the File interface the log readers
+   use, so the same record readers work on every storage.
+
+*/
+
+#ifndef HYDROMONITORLOGSTORAGE_H
+#define HYDROMONITORLOGSTORAGE_H
+
+#include <FS.h>
+
+class HydroMonitorLogStorage
+{
+  public:
+    virtual void begin(const char*) = 0;
+    virtual bool nextSegment(bool, uint32_t*, uint16_t*) = 0;
+    virtual uint32_t capacity(uint8_t) = 0;
+    virtual bool canGrow() = 0;
+    virtual bool append(uint32_t, const uint8_t*, uint16_t) = 0;
+    virtual uint16_t read(uint32_t, uint16_t, uint8_t*, uint16_t) = 0;
+    virtual void cut(uint32_t, uint16_t) = 0;
+    virtual void remove(uint32_t) = 0;
+    uint32_t bytesWritten = 0;                              // Bytes written to the medium since startup.
+};
+
+class HydroMonitorLogFile
+{
+  public:
+    HydroMonitorLogFile();
+    HydroMonitorLogFile(HydroMonitorLogStorage*, uint32_t, uint16_t, uint16_t);
+    size_t read(uint8_t*, size_t);
+    size_t readBytes(char*, size_t);
+    size_t readBytesUntil(char, char*, size_t);
+    bool seek(uint32_t, SeekMode = SeekSet);
+    size_t position();
+    size_t size();
+    void close();
+    operator bool() const;
+
+  private:
+    HydroMonitorLogStorage* storage;                        // NULL if not open.
+    uint32_t segment;
+    uint16_t offset;                                        // Read position in the segment.
+    uint16_t length;                                        // Length of the segment when it was opened.
+};
+#endif
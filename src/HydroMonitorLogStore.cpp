@@ -0,0 +1,184 @@
+#include <HydroMonitorLogStore.h>
+
+/*
+   Segmented, circular record storage for the data and message logs.
+*/
+
+/*
+   The constructor.
+*/
+HydroMonitorLogStore::HydroMonitorLogStore() {
+}
+
+/*
+   Open the store: find the existing segments, and decide how many segments we keep.
+
+   st: the storage of the segments.
+   dir: the directory holding the segment files, including the trailing slash.
+   share: the percentage of the free space this store may use, if the storage is shared.
+*/
+void HydroMonitorLogStore::begin(HydroMonitorLogStorage* st, const char* dir, uint8_t share) {
+  storage = st;
+  storage->begin(dir);
+  for (uint8_t i = 0; i < MAX_LOG_SEGMENTS; i++) {
+    segmentSize[i] = 0;
+  }
+
+  // Find the oldest and newest segments.
+  bool found = false;
+  uint32_t segment;
+  uint16_t length;
+  for (bool restart = true; storage->nextSegment(restart, &segment, &length); restart = false) {
+    if (found == false) {
+      firstSegment = segment;
+      headSegment = segment;
+      found = true;
+    }
+    firstSegment = min(firstSegment, segment);
+    headSegment = max(headSegment, segment);
+  }
+  if (found == false) {                                     // An empty store.
+    firstSegment = 0;
+    headSegment = 0;
+  }
+  while (headSegment - firstSegment >= MAX_LOG_SEGMENTS) {  // Shouldn't happen; clean up left-overs.
+    removeSegment();
+  }
+  for (bool restart = true; storage->nextSegment(restart, &segment, &length); restart = false) {
+    if (segment >= firstSegment) {                          // Now we know the range, record the sizes.
+      segmentSize[segment % MAX_LOG_SEGMENTS] = length;
+    }
+  }
+  nSegments = constrain(storage->capacity(share) / LOG_SEGMENT_SIZE, MIN_LOG_SEGMENTS, MAX_LOG_SEGMENTS);
+  released = first();
+}
+
+/*
+   Append a record of size bytes to the store.
+   Returns the position of the new record.
+*/
+uint32_t HydroMonitorLogStore::append(const uint8_t* record, uint16_t size) {
+  uint32_t start = micros();
+  if (segmentSize[headSegment % MAX_LOG_SEGMENTS] + size > LOG_SEGMENT_SIZE) { // Doesn't fit: start a new segment.
+    newSegment();
+  }
+  uint32_t position = end();
+  storage->append(headSegment, record, size);
+  segmentSize[headSegment % MAX_LOG_SEGMENTS] += size;
+  appends++;
+  appendTime = micros() - start;
+  maxAppendTime = max(maxAppendTime, appendTime);
+  return position;
+}
+
+/*
+   Open the segment holding the record at position, and set the file's read position to the record.
+   position is moved to the first record at or after it; if there is none, position is set to end() and the
+   returned file is not open.
+*/
+HydroMonitorLogFile HydroMonitorLogStore::open(uint32_t* position) {
+  *position = seek(*position);
+  if (*position == end()) {
+    return HydroMonitorLogFile();
+  }
+  uint32_t segment = *position / LOG_SEGMENT_SIZE;
+  return HydroMonitorLogFile(storage, segment, *position % LOG_SEGMENT_SIZE, segmentSize[segment % MAX_LOG_SEGMENTS]);
+}
+
+/*
+   Returns the position of the first record at or after position; end() if there is none.
+*/
+uint32_t HydroMonitorLogStore::seek(uint32_t position) {
+  if (position < first()) {                                 // Segment was removed; continue with the oldest we have.
+    position = first();
+  }
+  while (position < end()) {
+    uint32_t segment = position / LOG_SEGMENT_SIZE;
+    if (position % LOG_SEGMENT_SIZE < segmentSize[segment % MAX_LOG_SEGMENTS]) {
+      return position;
+    }
+    position = (segment + 1) * LOG_SEGMENT_SIZE;            // End of this segment; go to the next.
+  }
+  return end();
+}
+
+/*
+   Release all records before position: they have been dealt with, and their segments may be reclaimed.
+*/
+void HydroMonitorLogStore::truncate(uint32_t position) {
+  released = position;
+}
+
+/*
+   Position of the oldest record in the store.
+*/
+uint32_t HydroMonitorLogStore::first() {
+  return firstSegment * LOG_SEGMENT_SIZE;
+}
+
+/*
+   Position just after the newest record in the store.
+*/
+uint32_t HydroMonitorLogStore::end() {
+  return headSegment * LOG_SEGMENT_SIZE + segmentSize[headSegment % MAX_LOG_SEGMENTS];
+}
+
+/*
+   Number of segments the store keeps.
+*/
+uint8_t HydroMonitorLogStore::segments() {
+  return nSegments;
+}
+
+/*
+   Number of bytes stored in segment; 0 if the store doesn't have it.
+*/
+uint16_t HydroMonitorLogStore::segmentLength(uint32_t segment) {
+  return (segment >= firstSegment && segment <= headSegment) ? segmentSize[segment % MAX_LOG_SEGMENTS] : 0;
+}
+
+/*
+   Position of the start of the head segment.
+*/
+uint32_t HydroMonitorLogStore::headStart() {
+  return headSegment * LOG_SEGMENT_SIZE;
+}
+
+/*
+   Cut the head segment off at position: the bytes from there on are a torn record. New records are appended at
+   position.
+*/
+void HydroMonitorLogStore::cut(uint32_t position) {
+  if (position < headStart() || position >= end()) {
+    return;
+  }
+  storage->cut(headSegment, position % LOG_SEGMENT_SIZE);
+  cutBytes += end() - position;
+  segmentSize[headSegment % MAX_LOG_SEGMENTS] = position % LOG_SEGMENT_SIZE;
+}
+
+/*
+   Start a new head segment, and reclaim the oldest segments if we have too many.
+*/
+void HydroMonitorLogStore::newSegment() {
+  headSegment++;
+  segmentSize[headSegment % MAX_LOG_SEGMENTS] = 0;
+  while (headSegment - firstSegment >= nSegments) {
+    if (released < (firstSegment + 1) * LOG_SEGMENT_SIZE) { // Oldest segment still has unreleased records.
+      if (headSegment - firstSegment < MAX_LOG_SEGMENTS && storage->canGrow()) {
+        break;                                              // We have space: keep it.
+      }
+      droppedSegments++;
+    }
+    removeSegment();
+  }
+}
+
+/*
+   Remove the oldest segment.
+*/
+void HydroMonitorLogStore::removeSegment() {
+  storage->remove(firstSegment);
+  segmentSize[firstSegment % MAX_LOG_SEGMENTS] = 0;
+  firstSegment++;
+}
@@ -0,0 +1,70 @@
+/*
+   HydroMonitorLogStore
+
+   A circular log of records, stored in a set of segments. Where the segments are kept is up to the storage given
+   to begin() (see HydroMonitorLogStorage.h): files in SPIFFS or LittleFS, RAM, or an external EEPROM.
+
+   Records are appended to the head segment. When a record doesn't fit in the head segment any more a new
+   segment is started, so a record never spans two segments and rolling over never copies any data.
+   Each record is written with a single append call to the storage. The segment sizes are tracked in RAM, so
+   appending never has to ask the storage for a segment size.
+
+   Records are addressed by their position: segment number * LOG_SEGMENT_SIZE + offset in the segment file.
+   Positions only ever increase. seek() moves a position past the end of a segment to the start of the next one,
+   and past removed segments to the oldest record still stored.
+
+   The number of segments is set at startup from the capacity of the storage. When a new segment brings the
+   total over that number, the oldest segment is removed - but only if all its records have been released with
+   truncate(). Segments holding unreleased records are kept as long as the storage can grow (for a file system:
+   it has LOG_RESERVED_SPACE free) and there are no more than MAX_LOG_SEGMENTS; only then are they dropped
+   (counted in droppedSegments).
+
+   open() returns a HydroMonitorLogFile, which reads the segment through the storage.
+
+   A record torn by a power cut or reset can only be the last one of the head segment. The owner of the store,
+   which knows the record format, checks the head segment at startup, and cut() removes the torn bytes.
+
+*/
+
+#ifndef HYDROMONITORLOGSTORE_H
+#define HYDROMONITORLOGSTORE_H
+
+#include <HydroMonitorLogStorage.h>
+
+const uint16_t LOG_SEGMENT_SIZE = 4096;                     // Maximum size of a segment file.
+const uint8_t MIN_LOG_SEGMENTS = 2;
+const uint8_t MAX_LOG_SEGMENTS = 32;
+
+class HydroMonitorLogStore
+{
+  public:
+    HydroMonitorLogStore();
+    void begin(HydroMonitorLogStorage*, const char*, uint8_t);
+    uint32_t append(const uint8_t*, uint16_t);
+    HydroMonitorLogFile open(uint32_t*);
+    uint32_t seek(uint32_t);
+    void truncate(uint32_t);
+    uint32_t first();
+    uint32_t end();
+    uint8_t segments();
+    uint32_t headStart();
+    uint16_t segmentLength(uint32_t);
+    void cut(uint32_t);
+    uint32_t droppedSegments = 0;                           // Segments removed before all their records were released.
+    uint32_t appends = 0;                                   // Number of records appended since startup.
+    uint32_t appendTime = 0;                                // Duration of the latest append (us).
+    uint32_t maxAppendTime = 0;                             // Longest append since startup (us).
+    uint32_t cutBytes = 0;                                  // Bytes of torn records removed by cut().
+
+  private:
+    void newSegment();
+    void removeSegment();
+
+    HydroMonitorLogStorage* storage;
+    uint8_t nSegments;                                      // Number of segments to keep.
+    uint32_t firstSegment;                                  // Oldest segment in the store.
+    uint32_t headSegment;                                   // Segment we're appending to.
+    uint16_t segmentSize[MAX_LOG_SEGMENTS];                 // Size of each segment file, indexed by segment number % MAX_LOG_SEGMENTS.
+    uint32_t released;                                      // Records before this position may be removed.
+};
+#endif
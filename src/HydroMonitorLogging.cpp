@@ -1,5 +1,148 @@
 #include <HydroMonitorLogging.h>
 
+/*
+   The logged channels: how each is stored in a packed data record (DATA_SCHEMA_PACKED).
+   A value v is stored as the unsigned integer (v - zero) / scale, clipped to the field width.
+   Change this table (or the sensors compiled in) and the record size changes with it; records of another size
+   can't be decoded and are skipped.
+*/
+const HydroMonitorLogging::DataField HydroMonitorLogging::dataSchema[] = {
+  // SensorData member                                            type          width scale   zero   deadband name
+#ifdef USE_EC_SENSOR
+  {offsetof(HydroMonitorCore::SensorData, EC),                    FIELD_FLOAT,  2,    0.001,  0,     0.05,    "ec"},  // 0 - 65.535 mS/cm.
+  {offsetof(HydroMonitorCore::SensorData, fertiliserConcentration), FIELD_UINT16, 2,  1,      0,     10,      "fertiliser"},
+#endif
+#ifdef USE_BRIGHTNESS_SENSOR
+  {offsetof(HydroMonitorCore::SensorData, brightness),            FIELD_INT32,  4,    1,      0,     100,     "brightness"},
+#endif
+#if defined(USE_WATERTEMPERATURE_SENSOR) || defined(USE_ISOLATED_SENSOR_BOARD)
+  {offsetof(HydroMonitorCore::SensorData, waterTemp),             FIELD_FLOAT,  2,    0.01,   -50,   0.2,     "watertemp"},  // -50 - 605 C.
+#endif
+#ifdef USE_WATERLEVEL_SENSOR
+  {offsetof(HydroMonitorCore::SensorData, waterLevel),            FIELD_FLOAT,  2,    0.1,    0,     5,       "waterlevel"},  // 0 - 6553 mm.
+#endif
+#ifdef USE_PRESSURE_SENSOR
+  {offsetof(HydroMonitorCore::SensorData, pressure),              FIELD_FLOAT,  2,    0.1,    0,     1,       "pressure"},  // 0 - 6553 hPa.
+#endif
+#ifdef USE_TEMPERATURE_SENSOR
+  {offsetof(HydroMonitorCore::SensorData, temperature),           FIELD_FLOAT,  2,    0.01,   -50,   0.3,     "temperature"},
+#endif
+#ifdef USE_HUMIDITY_SENSOR
+  {offsetof(HydroMonitorCore::SensorData, humidity),              FIELD_FLOAT,  2,    0.01,   0,     2,       "humidity"},
+#endif
+#ifdef USE_PH_SENSOR
+  {offsetof(HydroMonitorCore::SensorData, pH),                    FIELD_FLOAT,  2,    0.001,  0,     0.05,    "ph"},  // 0 - 65.535.
+  {offsetof(HydroMonitorCore::SensorData, pHMinusConcentration),  FIELD_FLOAT,  2,    0.01,   0,     1,       "phminus"},
+#endif
+#ifdef USE_DO_SENSOR
+  {offsetof(HydroMonitorCore::SensorData, DO),                    FIELD_FLOAT,  2,    0.01,   0,     0.2,     "do"},
+#endif
+#ifdef USE_ORP_SENSOR
+  {offsetof(HydroMonitorCore::SensorData, ORP),                   FIELD_FLOAT,  2,    0.1,    -3000, 10,      "orp"},  // -3000 - 3553 mV.
+#endif
+#ifdef USE_GROWLIGHT
+  {offsetof(HydroMonitorCore::SensorData, growlight),             FIELD_BOOL,   1,    1,      0,     1,       "growlight"},
+#endif
+#if defined(USE_EC_SENSOR) || defined(USE_PH_SENSOR)
+  {offsetof(HydroMonitorCore::SensorData, solutionVolume),        FIELD_UINT16, 2,    1,      0,     5,       "volume"},
+#endif
+#ifdef USE_FLOW_SENSOR
+  {offsetof(HydroMonitorCore::SensorData, flow),                  FIELD_FLOAT,  2,    0.01,   0,     0.1,     "flow"},
+#endif
+#ifdef USE_ISOLATED_SENSOR_BOARD
+  {offsetof(HydroMonitorCore::SensorData, ecReading),             FIELD_UINT16, 2,    1,      0,     10,      "ecreading"},
+  {offsetof(HydroMonitorCore::SensorData, phReading),             FIELD_UINT16, 2,    1,      0,     10,      "phreading"},
+#endif
+  {offsetof(HydroMonitorCore::SensorData, systemStatus),          FIELD_UINT32, 4,    1,      0,     0,       "status"},
+};
+
+/*
+   The length of the rollup periods, indexed by ROLLUP_*.
+*/
+const uint32_t HydroMonitorLogging::rollupPeriod[] = {
+  60 * 60,                                                  // ROLLUP_HOURLY.
+  24 * 60 * 60,                                             // ROLLUP_DAILY.
+};
+
+/*
+   The message catalogue: the text of the coded warnings and errors, indexed by their MESSAGE_* code.
+   The codes are stored in the message log, so never change or reuse the index of an existing message; add new
+   ones at the end. See also "errors and warnings.txt".
+*/
+static const char message00[] PROGMEM = "WaterTempSensor 01: unusual temperature value measured: %2.1f C. Check water temperature sensor.";
+static const char message01[] PROGMEM = "WaterTempSensor 10: no DS18B20 temperature sensor found.";
+static const char message02[] PROGMEM = "WaterLevelSensor 01: the reservoir is almost empty, and is in urgent need of a refill. Current reservoir fill level:  %.1f %%.";
+static const char message03[] PROGMEM = "pHSensor 01: unusual pH level measured: %2.2f. Check sensor.";
+static const char message04[] PROGMEM = "pHSensor 02: pH level is too high; correction with pH adjuster is urgently needed. Target set: %2.2f, current pH: %2.2f.";
+static const char message05[] PROGMEM = "pHMinus 01: pH did not go down as expected after running the pump. pH- bottle may be empty.";
+static const char message06[] PROGMEM = "Logging 01: can not transmit messages or data: database login invalid.";
+static const char message07[] PROGMEM = "Logging 02: can not transmit messages or data: connection failed.";
+static const char message08[] PROGMEM = "Fertiliser 01: fertiliser did not go up as expected after running the pumps. Fertiliser bottles may be empty.";
+static const char message09[] PROGMEM = "ECSensor 01: EC level is too low; additional fertiliser is urgently needed. Target set: %2.2f mS/cm, current EC: %2.2f mS/cm.";
+static const char message10[] PROGMEM = "ECSensor 02: EC level is exceptionally high: %2.2f mS/cm. Check sensor.";
+static const char message11[] PROGMEM = "ECSensor 03: EC sensor not detected.";
+static const char message12[] PROGMEM = "Drainage 01: reservoir fill level too high for more than 2 minutes; draining the excess.";
+static const char message13[] PROGMEM = "Drainage 02: Automatic draining sequence not completed in 20 minutes; possible pump malfunction.";
+static const char message14[] PROGMEM = "Drainage 03: drainage of the excess not completed within 20 minutes; possible malfunction.";
+static const char message15[] PROGMEM = "Reservoir 10: float switch triggered, reservoir water level is critically high.";
+static const char message16[] PROGMEM = "Reservoir 11: shortly after the reservoir was topped up, water level dropped below the minimum already.";
+static const char message17[] PROGMEM = "Reservoir 12: water level >5%% over maxFill within 5 minutes of starting to fill the reservoir. Suspected problem with the filling system.";
+
+const char* const HydroMonitorLogging::messageCatalogue[] PROGMEM = {
+  message00, message01, message02, message03, message04, message05, message06, message07, message08, message09,
+  message10, message11, message12, message13, message14, message15, message16, message17,
+};
+
+/*
+   The module each message of the catalogue belongs to, for the log level filtering.
+*/
+const uint8_t HydroMonitorLogging::messageModule[] PROGMEM = {
+  LOG_MODULE_WATERTEMPSENSOR, LOG_MODULE_WATERTEMPSENSOR, LOG_MODULE_WATERLEVELSENSOR, LOG_MODULE_PHSENSOR,
+  LOG_MODULE_PHSENSOR, LOG_MODULE_PHMINUS, LOG_MODULE_LOGGING, LOG_MODULE_LOGGING, LOG_MODULE_FERTILISER,
+  LOG_MODULE_ECSENSOR, LOG_MODULE_ECSENSOR, LOG_MODULE_ECSENSOR, LOG_MODULE_DRAINAGE, LOG_MODULE_DRAINAGE,
+  LOG_MODULE_DRAINAGE, LOG_MODULE_RESERVOIR, LOG_MODULE_RESERVOIR, LOG_MODULE_RESERVOIR,
+};
+
+/*
+   The names of the modules, indexed by LOG_MODULE_*.
+*/
+static const char module00[] PROGMEM = "Main";
+static const char module01[] PROGMEM = "Logging";
+static const char module02[] PROGMEM = "Network";
+static const char module03[] PROGMEM = "EC sensor";
+static const char module04[] PROGMEM = "pH sensor";
+static const char module05[] PROGMEM = "Water temperature sensor";
+static const char module06[] PROGMEM = "Water level sensor";
+static const char module07[] PROGMEM = "Brightness sensor";
+static const char module08[] PROGMEM = "Temperature sensor";
+static const char module09[] PROGMEM = "Humidity sensor";
+static const char module10[] PROGMEM = "Pressure sensor";
+static const char module11[] PROGMEM = "Flow sensor";
+static const char module12[] PROGMEM = "Isolated sensor board";
+static const char module13[] PROGMEM = "Growlight";
+static const char module14[] PROGMEM = "Circulation";
+static const char module15[] PROGMEM = "Drainage";
+static const char module16[] PROGMEM = "Fertiliser";
+static const char module17[] PROGMEM = "pH minus";
+static const char module18[] PROGMEM = "Reservoir";
+static const char module19[] PROGMEM = "Growing parameters";
+
+const char* const HydroMonitorLogging::logModuleNames[] PROGMEM = {
+  module00, module01, module02, module03, module04, module05, module06, module07, module08, module09,
+  module10, module11, module12, module13, module14, module15, module16, module17, module18, module19,
+};
+
+/*
+   Size of the packed sensor data of a record.
+*/
+uint8_t HydroMonitorLogging::schemaSize() {
+  uint8_t size = 0;
+  for (uint8_t i = 0; i < sizeof(dataSchema) / sizeof(DataField); i++) {
+    size += dataSchema[i].width;
+  }
+  return size;
+}
+
 /*
    Take care of database connectivity (expects networking to be enabled).
 */
@@ -8,7 +151,18 @@
 /*
    The constructor.
 */
-HydroMonitorLogging::HydroMonitorLogging() {
+HydroMonitorLogging::HydroMonitorLogging() :
+  rollupStorage{HydroMonitorFileLogStorage(&LOG_FILESYSTEM), HydroMonitorFileLogStorage(&LOG_FILESYSTEM)},
+  dataStorage(&LOG_FILESYSTEM),
+#ifdef USE_24LC256_EEPROM
+  messageStorage(&LOG_FILESYSTEM),
+  dataHotStorage(&eepromPages, EEPROM_DATA_TIER_START, EEPROM_TIER_SIZE),
+  messageHotStorage(&eepromPages, EEPROM_MESSAGE_TIER_START, EEPROM_TIER_SIZE),
+  dataTier(&dataHotStorage, &dataStorage),
+  messageTier(&messageHotStorage, &messageStorage) {
+#else
+  messageStorage(&LOG_FILESYSTEM) {
+#endif
 
 }
 
@@ -38,126 +192,510 @@ void HydroMonitorLogging::begin(HydroMonitorCore::SensorData *sd) {
     EEPROM.commit();
 #endif
   }
+#ifdef USE_24LC256_EEPROM
+  sensorData->EEPROM->get(LOG_LEVELS_EEPROM, logLevel);
+#else
+  EEPROM.get(LOG_LEVELS_EEPROM, logLevel);
+#endif
+  for (uint8_t i = 0; i < LOG_MODULES; i++) {
+    if (logLevel[i] < LOG_OFF || logLevel[i] > LOG_TRACE) { // Never set (255): use the board's log level.
+      logLevel[i] = LOGLEVEL;
+    }
+  }
+#ifdef USE_24LC256_EEPROM
+  sensorData->EEPROM->get(LOG_SEQUENCE_EEPROM, sequenceLimit);
+#else
+  EEPROM.get(LOG_SEQUENCE_EEPROM, sequenceLimit);
+#endif
+  if (validSequence(sequenceLimit) == false) {              // Never set: start numbering at 1.
+    sequenceLimit = 1;
+  }
+  sequence = sequenceLimit;                                 // Continue after the last block reserved; nothing before it is used again.
 
-  // Set up the local storage (SPIFFS - store in flash).
-  SPIFFS.begin();                                           // Initialse the SPIFFS storage.
-  initMessageLogFile();                                     // Do this first to be able to properly receive new messages.
-  initDataLogFile();
+  // Set up the local storage (SPIFFS or LittleFS - store in flash).
+  LOG_FILESYSTEM.begin();                                   // Initialse the file system.
+#ifdef USE_24LC256_EEPROM
+  dataStore.begin(&dataTier, dataLogDirectory, 50);         // Data may use up to half the free space,
+  messageStore.begin(&messageTier, messageLogDirectory, 25); // messages a quarter.
+#else
+  dataStore.begin(&dataStorage, dataLogDirectory, 50);      // Data may use up to half the free space,
+  messageStore.begin(&messageStorage, messageLogDirectory, 25); // messages a quarter.
+#endif
+  messageStoreReady = true;
+  rollupStore[ROLLUP_HOURLY].begin(&rollupStorage[ROLLUP_HOURLY], hourlyRollupDirectory, 10);
+  rollupStore[ROLLUP_DAILY].begin(&rollupStorage[ROLLUP_DAILY], dailyRollupDirectory, 5);
+  for (uint8_t r = 0; r < ROLLUPS; r++) {
+    rollupStore[r].truncate(0xFFFFFFFF);                    // Rollups are not uploaded: the oldest may always be removed.
+    rollup[r].count = 0;
+  }
+  history.begin(sizeof(dataSchema) / sizeof(DataField));
+  repairTail(&dataStore, STORE_DATA);                       // Remove records torn by a power cut.
+  repairTail(&messageStore, STORE_MESSAGE);
+  for (uint8_t r = 0; r < ROLLUPS; r++) {
+    repairTail(&rollupStore[r], STORE_ROLLUP);
+  }
+  bool haveCursor = readCursor();                           // Where we were with transmission to the server.
+  if (LOG_FILESYSTEM.exists(dataLogFileName) || LOG_FILESYSTEM.exists(messageLogFileName)) {
+    migrateLogFiles(haveCursor && legacyCursor);            // Move unsent records of the old log files into the stores.
+  }
+  initMessageLog();                                         // Do this first to be able to properly receive new messages.
+  initDataLog();
+  writeCursor(true);                                        // Compact the journal.
+  flushMessages();                                          // The messages of the startup, in one go.
 }
 
 //*******************************************************************************************************************
-// Initialise the data logging.
-void HydroMonitorLogging::initDataLogFile() {
+// Read the transmission cursor from the journal: the last complete entry with a valid check word.
+// Returns false if there is no valid entry. Entries written before the log stores existed have a different check
+// word; for those legacyCursor is set.
+bool HydroMonitorLogging::readCursor() {
+#ifdef USE_24LC256_EEPROM
+  if (readEepromCursor()) {
+    return true;
+  }
+#endif
+  if (LOG_FILESYSTEM.exists(cursorLogFileName) == false) {
+    if (LOG_FILESYSTEM.exists(cursorLogFile1Name) == false) {
+      return false;
+    }
+    LOG_FILESYSTEM.rename(cursorLogFile1Name, cursorLogFileName);   // Compaction was interrupted before the rename.
+  }
+  bool found = false;
+  File f = LOG_FILESYSTEM.open(cursorLogFileName, "r");
+  Cursor cursor;
+  for (int32_t i = f.size() / sizeof(Cursor) - 1; i >= 0; i--) { // Start at the last entry; skip a torn one.
+    f.seek(i * sizeof(Cursor), SeekSet);
+    f.read((uint8_t*)&cursor, sizeof(Cursor));
+    uint32_t check = cursor.dataRecord ^ cursor.messageOffset;
+    if ((check ^ CURSOR_CHECK) == cursor.check ||
+        (check ^ LEGACY_CURSOR_CHECK) == cursor.check) {
+      dataRecordToTransmit = cursor.dataRecord;
+      messageToTransmit = cursor.messageOffset;
+      legacyCursor = ((check ^ LEGACY_CURSOR_CHECK) == cursor.check);
+      found = true;
+      break;
+    }
+  }
+  f.close();
+  return found;
+}
+
+//*******************************************************************************************************************
+// Append the current transmission cursor to the journal. Compacting rewrites the journal with just this entry.
+void HydroMonitorLogging::writeCursor(bool compact) {
+#ifdef USE_24LC256_EEPROM
+  if (writeEepromCursor()) {
+    if (compact) {                                          // The journal file is no longer needed.
+      LOG_FILESYSTEM.remove(cursorLogFileName);
+      LOG_FILESYSTEM.remove(cursorLogFile1Name);
+    }
+    return;
+  }
+#endif
+  Cursor cursor = {dataRecordToTransmit, messageToTransmit, dataRecordToTransmit ^ messageToTransmit ^ CURSOR_CHECK};
   File f;
-  if (SPIFFS.exists(dataLogFileName) == false) {            // If the data log does not exist,
-    f = SPIFFS.open(dataLogFileName, "w");                  // create it.
+  if (compact == false) {
+    f = LOG_FILESYSTEM.open(cursorLogFileName, "a");
+    f.write((uint8_t*)&cursor, sizeof(Cursor));
+    compact = (f.size() > MAX_CURSOR_JOURNAL_SIZE);
     f.close();
-    dataTransmitComplete = true;
-    dataRecordToTransmit = 0;
-  }
-  else {                                                    // Data log exists already, figure out how far we were with transmission to the server->
-    f = SPIFFS.open(dataLogFileName, "r");
-    uint32_t nRecords = f.size() / fileRecordSize;          // Calculate number of records in the file.
-    if (f.size() != nRecords * fileRecordSize) {            // Basic sanity check.
-      Serial.println(F("Data record file corrupt; creating a new one."));
-      f.close();
-      SPIFFS.remove(dataLogFileName);
-      f = SPIFFS.open(dataLogFileName, "w");                // create a new one.
-      f.close();
-      dataRecordToTransmit = 0;
+  }
+  if (compact) {                                            // Write the new journal next to the old one, then swap.
+    f = LOG_FILESYSTEM.open(cursorLogFile1Name, "w");
+    f.write((uint8_t*)&cursor, sizeof(Cursor));
+    f.close();
+    LOG_FILESYSTEM.remove(cursorLogFileName);
+    LOG_FILESYSTEM.rename(cursorLogFile1Name, cursorLogFileName);
+  }
+}
+
+#ifdef USE_24LC256_EEPROM
+//*******************************************************************************************************************
+// Read the transmission cursor from the EEPROM ring: the valid entry with the highest serial.
+// Returns false if there is no valid entry.
+bool HydroMonitorLogging::readEepromCursor() {
+  bool found = false;
+  EepromCursor entry;
+  for (uint8_t i = 0; i < EEPROM_CURSOR_ENTRIES; i++) {
+    eepromPages.read(EEPROM_CURSOR_START + i * sizeof(EepromCursor), (uint8_t*)&entry, sizeof(EepromCursor));
+    if ((entry.dataRecord ^ entry.messageOffset ^ entry.serial ^ CURSOR_CHECK) == entry.check &&
+        (found == false || entry.serial > cursorSerial)) {
+      dataRecordToTransmit = entry.dataRecord;
+      messageToTransmit = entry.messageOffset;
+      cursorSlot = i;
+      cursorSerial = entry.serial;
+      found = true;
     }
-    else {
-      dataTransmitComplete = false;
-      for (int32_t i = nRecords - 1; i >= 0; i--) {           // Start searching at the last record - usually less file to search through this way.
-        f.seek(i * fileRecordSize, SeekSet);                  // Set file pointer to the beginning of the record.
-        char recordStatus[1];
-        f.readBytes((char *)recordStatus, 1);                 // Read the status byte of this record.
-        if (recordStatus[0] == RECORD_TRANSMITTED) {          // This record has been transmitted already.
-          dataRecordToTransmit = i + 1;                       // Store which one is next in line to be transmitted.
-          if (dataRecordToTransmit == nRecords) {             // Last record has been transmitted already, so it's complete already.
-            dataTransmitComplete = true;
-          }
-          break;                                              // We've found what we're looking for.
-        }
-      }
-      connectionFailTime = -CONNECTION_RETRY_DELAY;           // We want to start transmitting right away!
-      sprintf_P(buff, PSTR("HydroMonitorLogging: data points in this file: %d."), nRecords);
-      writeTrace(buff);
+  }
+  legacyCursor = false;
+  return found;
+}
+
+//*******************************************************************************************************************
+// Write the current transmission cursor to the next entry of the EEPROM ring: a single page write.
+// Returns false if the EEPROM didn't take it.
+bool HydroMonitorLogging::writeEepromCursor() {
+  cursorSlot = (cursorSlot + 1) % EEPROM_CURSOR_ENTRIES;
+  cursorSerial++;
+  EepromCursor entry = {dataRecordToTransmit, messageToTransmit, cursorSerial,
+                        dataRecordToTransmit ^ messageToTransmit ^ cursorSerial ^ CURSOR_CHECK
+                       };
+  return eepromPages.write(EEPROM_CURSOR_START + cursorSlot * sizeof(EepromCursor), (uint8_t*)&entry, sizeof(EepromCursor));
+}
+#endif
+
+//*******************************************************************************************************************
+// Check the records of the head segment of store, which holds records of type, and cut it off after the last
+// valid record: what follows is a record of which the write was interrupted, or garbage after it.
+void HydroMonitorLogging::repairTail(HydroMonitorLogStore* store, StoreTypes type) {
+  uint32_t start = store->headStart();
+  uint32_t position = start;
+  HydroMonitorLogFile f = store->open(&position);
+  if (!f || position != start) {                            // Empty head segment.
+    return;
+  }
+  uint32_t size = f.size();
+  HydroMonitorCore::SensorData values[3];
+  while (position - start < size) {
+    f.seek(position - start, SeekSet);
+    uint16_t recordSize;
+    uint32_t timestamp;
+    uint16_t count;
+    switch (type) {
+      case STORE_DATA:
+        recordSize = readDataRecord(&f, &timestamp, values);
+        break;
+      case STORE_ROLLUP:
+        recordSize = readRollupRecord(&f, &timestamp, values, &count);
+        break;
+      default:
+        recordSize = readMessageRecord(&f, false);
+        break;
+    }
+    if (recordSize == 0 || position - start + recordSize > size) { // Torn or damaged: cut it off here.
+      break;
     }
+    position += recordSize;
   }
-  sprintf_P(buff, PSTR("HydroMonitorLogging: first unsent data point: #%d."), dataRecordToTransmit);
-  writeTrace(buff);
-  Serial.print(F("Sensor data logging is "));
-  Serial.println((dataTransmitComplete) ? F("completed") : F("not completed."));
   f.close();
+  if (position - start < size) {
+    store->cut(position);
+    sprintf_P(buff, PSTR("HydroMonitorLogging: removed a torn record of %u bytes at position %u."),
+              size - (position - start), position);
+    writeWarning(LOG_MODULE_LOGGING, buff);
+  }
 }
 
 //*******************************************************************************************************************
-// Initialise the message logging.
-//
-void HydroMonitorLogging::initMessageLogFile() {
+// Move the records not yet transmitted from the old single-file logs (datalog, messagelog) into the log stores,
+// and remove the old files. This is done only once, the first time we start with the log stores.
+// haveCursor: the resume points of the old files have been read from the journal; otherwise they're taken from
+// the RECORD_TRANSMITTED status bytes.
+void HydroMonitorLogging::migrateLogFiles(bool haveCursor) {
+  uint32_t dataStart = (haveCursor) ? dataRecordToTransmit : 0;
+  uint32_t messageStart = (haveCursor) ? messageToTransmit : 0;
+  dataRecordToTransmit = dataStore.end();                   // The migrated records are the first ones to transmit.
+  messageToTransmit = messageStore.end();
+  uint32_t nData = 0;
+  uint32_t nMessages = 0;
 
-  File f;
-  uint32_t nMessages = 0;                                   // Total number of messages in the file.
-  messageTransmitComplete = true;
-  if (SPIFFS.exists(messageLogFileName) == false) {         // If the messages log does not exist,
-    f = SPIFFS.open(messageLogFileName, "w");               // create it.
+  File f = LOG_FILESYSTEM.open(dataLogFileName, "r");
+  if (f) {
+    uint32_t nRecords = f.size() / legacyRecordSize;
+    for (uint32_t i = 0; i < nRecords; i++) {
+      f.seek(i * legacyRecordSize, SeekSet);
+      f.readBytes(buff, 1);
+      if (haveCursor == false && buff[0] == RECORD_TRANSMITTED) {
+        dataStart = i + 1;                                  // Everything up to here has been transmitted.
+      }
+    }
+    uint8_t dataRecord[fileRecordSize];
+    DataHeader* header = (DataHeader*)dataRecord;
+    HydroMonitorCore::SensorData dataEntry;
+    for (uint32_t i = dataStart; i < nRecords; i++) {       // Copy the records, converted to the packed format.
+      f.seek(i * legacyRecordSize, SeekSet);
+      memset(header, 0, sizeof(DataHeader));
+      f.read(dataRecord, sizeof(DataHeader));
+      f.read((uint8_t*)&dataEntry, sizeof(HydroMonitorCore::SensorData));
+      header->status = RECORD_CHECKED;
+      header->schema = DATA_SCHEMA_PACKED;
+      header->size = dataRecordSize;
+      header->sequence = nextSequence();
+      packData(dataRecord + sizeof(DataHeader), &dataEntry);
+      sealRecord(dataRecord, fileRecordSize);
+      dataStore.append(dataRecord, fileRecordSize);
+      nData++;
+    }
     f.close();
-    messageToTransmit = 0;                                  // Seek index: start of first message due to be transmitted.
   }
-  else {                                                    // Data log exists already, figure out how far we were with transmission to the server.
-    f = SPIFFS.open(messageLogFileName, "r");
 
-    // Search file for the latest sent message.
-    uint32_t i = 0;                                         // The search index.
-    if (f.size() > 0) {                                     // We have at least one message, otherwise the file size is zero.
-      uint16_t nBytes;
-      uint8_t status;
-      while (i < f.size()) {                                // Search the file until the end.
+  f = LOG_FILESYSTEM.open(messageLogFileName, "r");
+  if (f) {
+    for (uint8_t pass = (haveCursor) ? 1 : 0; pass < 2; pass++) { // Find the first unsent message, then copy from there.
+      uint32_t i = (pass == 0) ? 0 : messageStart;
+      while (i < f.size()) {
         f.seek(i, SeekSet);
-        status = f.read();                                  // Read the message status byte.
-        f.seek(i + 16, SeekSet);                            // Set search pointer to start of the logged message - skipping the header bytes.
-        nBytes = f.readBytesUntil('\0', buff, MAX_MESSAGE_SIZE); // Get total size of the stored message.
-        if ((status == RECORD_STORED || status == RECORD_TRANSMITTED) &&
-            nBytes <= MAX_MESSAGE_SIZE) {                   // Record appears sound.
-          nMessages++;                                      // Keep track of total number of messages we have stored.
-          addMessageToList(i);                              // Keep track of the starting points of the last 50 messages.
-          i += nBytes + 17;                                 // Set index to start of the next message (which starts nBytes + 16 header + 1 null terminator further).
-          if (status == RECORD_TRANSMITTED) {               // This message has been transmitted already,
-            messageToTransmit = i;                          // but maybe the next not yet. Set start index to that point.
-          }
+        f.readBytes(control, 16);
+        uint16_t nBytes = f.readBytesUntil('\0', buff, MAX_MESSAGE_SIZE);
+        if (control[0] != RECORD_STORED && control[0] != RECORD_TRANSMITTED) {
+          break;                                            // Corrupt record; stop here.
         }
-        else {
-          f.close();
-          SPIFFS.remove(messageLogFileName);
-          f = SPIFFS.open(messageLogFileName, "w");         // create a new one.
-          f.close();
-          nMessages = 0;
-          messageToTransmit = 0;
-          writeTrace(F("Message log file corrupt; removed this."));
-          break;
+        i += nBytes + 17;
+        if (pass == 0 && haveCursor == false && control[0] == RECORD_TRANSMITTED) {
+          messageStart = i;
+        }
+        if (pass == 1) {
+          buff[nBytes] = 0;
+          control[0] = RECORD_CHECKED;
+          ((MessageHeader*)control)->sequence = nextSequence();
+          sealRecord((uint8_t*)record, 16 + nBytes + 1);
+          messageStore.append((uint8_t*)record, 16 + nBytes + 1); // control and buff together form the record.
+          nMessages++;
         }
       }
     }
+    f.close();
   }
-  sprintf_P(buff, PSTR("HydroMonitorLogging: messages in this file: %d."), nMessages);
-  writeTrace(buff);
-  sprintf_P(buff, PSTR("HydroMonitorLogging: first unsent message starts at byte %d."), messageToTransmit);
-  writeTrace(buff);
-  if (messageToTransmit < f.size() &&
-      f.size() > 0) {                                       // We have unsent messages.
-    messageTransmitComplete = false;
-    Serial.println(F("We have messages to transmit."));
+  writeCursor(true);                                        // Journal now points into the stores.
+  LOG_FILESYSTEM.remove(dataLogFileName);
+  LOG_FILESYSTEM.remove(dataLogFile1Name);
+  LOG_FILESYSTEM.remove(messageLogFileName);
+  LOG_FILESYSTEM.remove(messageLogFile1Name);
+  if (isLogged(LOG_MODULE_LOGGING, LOG_TRACE)) {
+    sprintf_P(buff, PSTR("HydroMonitorLogging: moved %u data points and %u messages from the old log files."), nData, nMessages);
+    writeTrace(LOG_MODULE_LOGGING, buff);
+  }
+}
+
+//*******************************************************************************************************************
+// Initialise the data logging.
+void HydroMonitorLogging::initDataLog() {
+  dataRecordToTransmit = dataStore.seek(dataRecordToTransmit); // In case segments were removed.
+  dataStore.truncate(dataRecordToTransmit);                 // Everything before this has been transmitted.
+  dataTransmitComplete = (dataRecordToTransmit == dataStore.end());
+  if (isLogged(LOG_MODULE_LOGGING, LOG_TRACE)) {
+    sprintf_P(buff, PSTR("HydroMonitorLogging: data log has %u segments, records %u - %u."),
+              dataStore.segments(), dataStore.first(), dataStore.end());
+    writeTrace(LOG_MODULE_LOGGING, buff);
+    sprintf_P(buff, PSTR("HydroMonitorLogging: first unsent data point at: %u."), dataRecordToTransmit);
+    writeTrace(LOG_MODULE_LOGGING, buff);
+  }
+  Serial.print(F("Sensor data logging is "));
+  Serial.println((dataTransmitComplete) ? F("completed") : F("not completed."));
+}
+
+//*******************************************************************************************************************
+// Initialise the message logging: bring the message index up to date, and load the latest messages in the cache
+// for the web interface.
+void HydroMonitorLogging::initMessageLog() {
+
+  // Find where the index ends in the message log.
+  uint32_t position = messageStore.first();
+  File f = LOG_FILESYSTEM.open(messageIndexFileName, "r");
+  indexCount = f.size() / sizeof(uint32_t);
+  if (indexCount > 0) {
+    f.seek((indexCount - 1) * sizeof(uint32_t), SeekSet);
+    f.read((uint8_t*)&position, sizeof(uint32_t));          // The last indexed message.
+    uint32_t last = position;
+    HydroMonitorLogFile m = messageStore.open(&position);
+    uint16_t recordSize = (m && position == last) ? readMessageRecord(&m, false) : 0;
+    m.close();
+    if (recordSize == 0) {                                  // Index doesn't match the log: start over.
+      f.close();
+      LOG_FILESYSTEM.remove(messageIndexFileName);
+      indexCount = 0;
+      position = messageStore.first();
+    }
+    else {
+      position += recordSize;
+    }
+  }
+  f.close();
+  indexReady = true;
+
+  // Index the messages that were stored after that.
+  uint32_t nMessages = 0;
+  File index = LOG_FILESYSTEM.open(messageIndexFileName, "a");
+  HydroMonitorLogFile m = messageStore.open(&position);
+  while (m) {
+    m.seek(position % LOG_SEGMENT_SIZE, SeekSet);
+    uint16_t recordSize = readMessageRecord(&m, false);     // Get total size of the stored message.
+    if (recordSize == 0) {
+      break;                                                // Corrupt record; stop here.
+    }
+    nMessages++;
+    addMessage(&index, position, (MessageHeader*)control, (uint8_t*)buff, recordSize - sizeof(MessageHeader));
+    position += recordSize;
+    if (position % LOG_SEGMENT_SIZE >= m.size() ||
+        position % LOG_SEGMENT_SIZE == 0) {                 // End of the segment: continue in the next.
+      m.close();
+      m = messageStore.open(&position);
+    }
+  }
+  m.close();
+  index.close();
+  if (indexCount * sizeof(uint32_t) > MAX_MESSAGE_INDEX_SIZE) {
+    compactMessageIndex();
+  }
+
+  // Load the latest messages in the cache.
+  messageCache.clear();
+  f = LOG_FILESYSTEM.open(messageIndexFileName, "r");
+  for (uint32_t i = (indexCount > MESSAGE_CACHE_ENTRIES) ? indexCount - MESSAGE_CACHE_ENTRIES : 0; i < indexCount; i++) {
+    f.seek(i * sizeof(uint32_t), SeekSet);
+    f.read((uint8_t*)&position, sizeof(uint32_t));
+    uint32_t wanted = position;
+    HydroMonitorLogFile m = messageStore.open(&position);
+    if (m && position == wanted) {
+      uint16_t recordSize = readMessageRecord(&m, false);
+      if (recordSize > 0) {
+        MessageHeader* header = (MessageHeader*)control;
+        HydroMonitorMessageCache::Entry entry = {(uint16_t)(recordSize - sizeof(MessageHeader)), header->level,
+                                                 header->format, header->timestamp};
+        messageCache.add(&entry, (uint8_t*)buff);
+      }
+    }
+    m.close();
   }
   f.close();
-  writeTrace(F("HydroMonitorLogging: configured message logging facility."));
+
+  messageToTransmit = messageStore.seek(messageToTransmit); // In case segments were removed.
+  messageStore.truncate(messageToTransmit);                 // Everything before this has been transmitted.
+  messageTransmitComplete = (messageToTransmit == messageStore.end());
+  urgentNext[HydroMonitorUploadScheduler::QUEUE_ERRORS] = messageToTransmit;
+  urgentNext[HydroMonitorUploadScheduler::QUEUE_WARNINGS] = messageToTransmit;
+  if (isLogged(LOG_MODULE_LOGGING, LOG_TRACE)) {
+    sprintf_P(buff, PSTR("HydroMonitorLogging: messages indexed: %u, of which new: %u."), indexCount, nMessages);
+    writeTrace(LOG_MODULE_LOGGING, buff);
+    sprintf_P(buff, PSTR("HydroMonitorLogging: first unsent message starts at: %u."), messageToTransmit);
+    writeTrace(LOG_MODULE_LOGGING, buff);
+  }
+  if (messageTransmitComplete == false) {                   // We have unsent messages.
+    Serial.println(F("We have messages to transmit."));
+  }
+  writeTrace(LOG_MODULE_LOGGING, F("HydroMonitorLogging: configured message logging facility."));
+}
+
+//*******************************************************************************************************************
+// A message was added to the message log at position: add it to the cache, and to the index file opened by the
+// caller. The caller compacts the index when it has grown too big.
+// body: the text (including null terminator) or code and arguments, of size bytes.
+void HydroMonitorLogging::addMessage(File* index, uint32_t position, MessageHeader* header, const uint8_t* body,
+                                     uint16_t size) {
+  HydroMonitorMessageCache::Entry entry = {size, header->level, header->format, header->timestamp};
+  messageCache.add(&entry, body);
+  if (indexReady == false) {                                // Messages written during startup are indexed by initMessageLog().
+    return;
+  }
+  index->write((uint8_t*)&position, sizeof(uint32_t));
+  indexCount++;
+}
+
+//*******************************************************************************************************************
+// Add a complete message record to the message buffer. Errors are stored right away, the others when the buffer
+// reaches MESSAGE_BUFFER_HIGH_WATER or when it's been MESSAGE_FLUSH_INTERVAL since the last flush.
+void HydroMonitorLogging::bufferMessage(const uint8_t* record, uint16_t size) {
+  if (messageBufferSize + size > MESSAGE_BUFFER_SIZE) {     // No room: store what we have first.
+    flushMessages();
+  }
+  if (messageBufferSize + size > MESSAGE_BUFFER_SIZE) {     // Still no room: the log is not available yet.
+    messagesDropped++;
+    return;
+  }
+  memcpy(messageBuffer + messageBufferSize, record, size);
+  messageBufferSize += size;
+  if (((MessageHeader*)record)->level <= LOG_ERROR || messageBufferSize >= MESSAGE_BUFFER_HIGH_WATER) {
+    flushMessages();
+  }
+}
+
+//*******************************************************************************************************************
+// Store the buffered messages in the message log, as a group: all messages that fit in the head segment with a
+// single write, and all index entries with a single open of the index file.
+void HydroMonitorLogging::flushMessages() {
+  lastMessageFlush = millis();
+  if (messageBufferSize == 0 || messageStoreReady == false) {
+    return;
+  }
+  File index = LOG_FILESYSTEM.open(messageIndexFileName, "a");
+  uint16_t done = 0;
+  while (done < messageBufferSize) {
+    uint16_t room = LOG_SEGMENT_SIZE - (messageStore.end() - messageStore.headStart());
+    if (messageRecordSize(messageBuffer + done) > room) {   // append() starts a new segment.
+      room = LOG_SEGMENT_SIZE;
+    }
+    uint16_t size = 0;                                      // The records that fit in the segment.
+    while (done + size < messageBufferSize) {
+      uint16_t recordSize = messageRecordSize(messageBuffer + done + size);
+      if (size + recordSize > room) {
+        break;
+      }
+      size += recordSize;
+    }
+    uint32_t position = messageStore.append(messageBuffer + done, size);
+    for (uint16_t offset = 0; offset < size; ) {
+      MessageHeader* header = (MessageHeader*)(messageBuffer + done + offset);
+      uint16_t recordSize = messageRecordSize((uint8_t*)header);
+      addMessage(&index, position + offset, header, (uint8_t*)(header + 1), recordSize - sizeof(MessageHeader));
+      offset += recordSize;
+    }
+    done += size;
+  }
+  index.close();
+  messageBufferSize = 0;
+  messageTransmitComplete = false;                          // Because we just added new ones!
+  if (indexCount * sizeof(uint32_t) > MAX_MESSAGE_INDEX_SIZE) {
+    compactMessageIndex();
+  }
+}
+
+//*******************************************************************************************************************
+// Size of the message record in the message buffer.
+uint16_t HydroMonitorLogging::messageRecordSize(const uint8_t* record) {
+  MessageHeader* header = (MessageHeader*)record;
+  if (header->format == MESSAGE_CODED) {
+    return sizeof(MessageHeader) + header->size;
+  }
+  return sizeof(MessageHeader) + strlen((char*)(record + sizeof(MessageHeader))) + 1;
 }
 
-void HydroMonitorLogging::addMessageToList(uint32_t msgIndex) {
-  for (uint8_t i = 1; i < 50; i++) {
-    latestMessageList[50 - i] = latestMessageList[49 - i];
+//*******************************************************************************************************************
+// Remove the index entries of messages that are no longer in the log; if that's not enough, the oldest half.
+void HydroMonitorLogging::compactMessageIndex() {
+  File f = LOG_FILESYSTEM.open(messageIndexFileName, "r");
+  uint32_t position;
+  uint32_t live = 0;                                        // Entries of messages still in the log.
+  for (uint32_t i = 0; i < indexCount; i++) {
+    f.read((uint8_t*)&position, sizeof(uint32_t));
+    if (position >= messageStore.first()) {
+      live++;
+    }
+  }
+  uint32_t keep = live;
+  if (live * sizeof(uint32_t) > MAX_MESSAGE_INDEX_SIZE) {   // Still too big: keep the newest half.
+    keep = MAX_MESSAGE_INDEX_SIZE / sizeof(uint32_t) / 2;
+  }
+  File f1 = LOG_FILESYSTEM.open(messageIndexFile1Name, "w");
+  f.seek(0, SeekSet);
+  uint32_t skip = live - keep;                              // The oldest live entries to drop.
+  uint32_t n = 0;
+  for (uint32_t i = 0; i < indexCount; i++) {
+    f.read((uint8_t*)&position, sizeof(uint32_t));
+    if (position < messageStore.first()) {
+      continue;
+    }
+    if (skip > 0) {
+      skip--;
+      continue;
+    }
+    f1.write((uint8_t*)&position, sizeof(uint32_t));
+    n++;
   }
-  latestMessageList[0] = msgIndex;
+  f.close();
+  f1.close();
+  LOG_FILESYSTEM.remove(messageIndexFileName);
+  LOG_FILESYSTEM.rename(messageIndexFile1Name, messageIndexFileName);
+  indexCount = n;
 }
 
 /********************************************************************************************************************
@@ -165,238 +703,1083 @@ void HydroMonitorLogging::addMessageToList(uint32_t msgIndex) {
 */
 void HydroMonitorLogging::logData() {
 
-  // Every REFRESH_DATABASE milliseconds: log the sensor data, and try to transmit it to the database.
-  if (millis() - lastLogSensorData > REFRESH_DATABASE) {
-    lastLogSensorData += REFRESH_DATABASE;
-    dataTransmitComplete = false;                           // We're adding a new record, so transmission is required.
-    File f = SPIFFS.open(dataLogFileName, "a");             // Open the file, append mode.
-    f.write(RECORD_STORED);                                 // First byte: status (it's merely stored at the moment).
-    uint32_t timestamp = now();
-    f.write(timestamp & 0xFF);                              // Bytes 1-4: the time stamp.
-    f.write(timestamp >> 8) & 0xFF;
-    f.write(timestamp >> 16) & 0xFF;
-    f.write(timestamp >> 24);
-    for (uint8_t i = 0; i < 11; i++) {
-      f.write('\0');                                        // Fill the rest of the header with zeros.
-    }
-    memcpy(buff, sensorData, dataRecordSize);               // Make a copy for easier writing to the file.
-    for (uint8_t i = 0; i < dataRecordSize; i++) {
-      f.write(buff[i]);
-    }
-    Serial.print(F("New sensor data point logged. New data file size: "));
-    Serial.println(f.size());
-    f.close();
-    dataTransmitComplete = false;                           // We have a new record to transmit!
+  // Start a capture window when a trigger bit is set; it ends CAPTURE_DURATION after the trigger bits are cleared.
+  uint32_t triggers = sensorData->systemStatus & CAPTURE_TRIGGERS;
+  if (triggers != 0) {
+    captureStart = millis();
+    capturing = true;
+  }
+  else if (capturing && millis() - captureStart > CAPTURE_DURATION) {
+    capturing = false;
+  }
 
-    // Check log file size, and if needed roll over into a new file.
-    f = SPIFFS.open(dataLogFileName, "r");
-    if (f.size() > MAX_FILE_SIZE) {
-      f.close();
-      if (SPIFFS.exists(dataLogFile1Name)) {                // Check on the rollover file; if it exists, remove it.
-        SPIFFS.remove(dataLogFile1Name);
-      }
-      SPIFFS.rename(dataLogFileName, dataLogFile1Name);     // Rename the original log to the rollover file.
-      f = SPIFFS.open(dataLogFileName, "w");                // Create a new logfile.
-      uint32_t nBytes = fileRecordSize * 20;                // Copy the latest 20 entries from the old log file to the new one.
-      File f1 = SPIFFS.open(dataLogFile1Name, "r");
-      f1.seek(f1.size() - nBytes, SeekSet);
-      for (uint32_t i = 0; i < nBytes; i++) {
-        f.write(f1.read());
-      }
-      f1.close();
-      for (uint8_t i = 0; i < 50; i++) {
-        latestMessageList[i] = 0;
-      }
+  // Check the sensor data for changes, and store it if there are any.
+  if (millis() - lastSample >= ((capturing) ? CAPTURE_INTERVAL : LOG_SAMPLE_INTERVAL) ||
+      (triggers & ~lastTriggers) != 0) {                    // A new trigger: don't wait for the next sample.
+    lastSample = millis();
+    lastTriggers = triggers;
+    if (millis() - lastStored >= LOG_HEARTBEAT_INTERVAL || dataChanged()) {
+      storeData();
     }
-    f.close();
+    else {
+      recordsSuppressed++;
+    }
+  }
+
+  // Every REFRESH_DATABASE milliseconds: add the sensor data to the rollups and the history.
+  if (millis() - lastLogSensorData > REFRESH_DATABASE) {
+    if (millis() - lastLogSensorData > 2 * REFRESH_DATABASE) { // Missed more than one interval: start over from now,
+      lastLogSensorData = millis();                         // rather than adding a burst of samples to catch up.
+    }
+    else {
+      lastLogSensorData += REFRESH_DATABASE;
+    }
+    addToRollups(now(), sensorData);
+    addToHistory(now(), sensorData);
+  }
+
+  // Store the buffered messages, if they've been waiting long enough.
+  if (messageBufferSize > 0 && millis() - lastMessageFlush > MESSAGE_FLUSH_INTERVAL) {
+    flushMessages();
   }
 
   // Transmit messages & data - if we can do this now.
-  static bool credentialsChecked = false;                   // We have to check credentials after WiFi is up.
-  if (bitRead(sensorData->systemStatus, STATUS_WATERING) == false && // Don't do this while watering.
-      WiFi.status() == WL_CONNECTED &&                      // We're connected to WiFi.
-      millis() - lastSent > 1000) {                         // Wait at least a second before sending another record for responsiveness.
-    if (credentialsChecked == false) {                      // We didn't check credentials yet.
-      checkCredentials();                                   // Do this now.
-      credentialsChecked = true;
-    }
-    if (loginValid != VALID) {                              // We need a valid login to be set.
+  // Uploads run in the background: each call does a bit of work on the upload in progress.
+  static bool credentialsStarted = false;                   // We have to check credentials after WiFi is up.
+#ifdef LOG_MQTT
+  if (mqtt.connected()) {                                   // Publishing: the broker's acknowledgements set the pace.
+    publishRecords();
+    return;
+  }
+#endif
+  if (upload != UPLOAD_NONE) {                              // Continue with the upload in progress.
+    int16_t result = connection.poll();
+#ifdef UPLOAD_TEST_LATENCY
+    if (result != CONNECTION_BUSY && millis() - uploadStarted < UPLOAD_TEST_LATENCY) {
+      result = CONNECTION_BUSY;                             // Test: hold the response back.
+    }
+#endif
+    if (result != CONNECTION_BUSY) {
+#ifdef UPLOAD_TEST_FAILURES
+      if (random(100) < UPLOAD_TEST_FAILURES) {
+        result = CONNECTION_TIMEOUT;                        // Test: pretend the upload failed.
+      }
+#endif
+      uploadFinished(result);
+    }
+  }
+  else if (WiFi.status() == WL_CONNECTED) {                 // We're connected to WiFi.
+    if (credentialsStarted == false) {                      // We didn't check credentials yet.
+      checkCredentials();                                   // Start this now; the check runs like an upload.
+      credentialsStarted = true;
+    }
+    else if (loginValid != VALID) {                         // We need a valid login to be set.
       if (millis() - lastWarned > WARNING_INTERVAL) {       // Produce warnings now and then if this is not set.
+        writeWarning(MESSAGE_LOGGING_01);
+        lastWarned = millis();
         checkCredentials();                                 // Check again for good measure. You never know.
-        if (loginValid != VALID) {                          // Still not? Produce the warning for real.
-          writeWarning(F("Logging 01: can not transmit messages or data: database login invalid."));
-          lastWarned = millis();
-        }
       }
     }
-    else if (connectionFailed) {                            // If the connection failed,
-      if (millis() - connectionFailTime > CONNECTION_RETRY_DELAY) { // wait some time before trying again.
-        connectionFailed = false;
-      }
-      if (millis() - lastWarned > WARNING_INTERVAL) {       // Produce warning if it's been long enough.
-        writeWarning(F("Logging 02: can not transmit messages or data: connection failed."));
+    else if (scheduler.ready() == false) {                  // Waiting to retry after a failure, or for the rate limit.
+      if (scheduler.failures() >= FAILURES_BEFORE_WARNING &&
+          millis() - lastWarned > WARNING_INTERVAL) {       // Produce warning if it's been long enough.
+        writeWarning(MESSAGE_LOGGING_02);
         lastWarned = millis();
       }
     }
     else {                                                  // Everything checked out; we can try to send messages and data now.
-      if (dataTransmitComplete == false) {                  // We have data points to transmit.
-        Serial.print(F("Going to transmit sensor data point #"));
-        Serial.println(dataRecordToTransmit);
-        transmitData();
+#ifdef LOG_MQTT
+      if (dataTransmitComplete == false || messageTransmitComplete == false) {
+        connectMqtt();
+      }
+#else
+      uint8_t pending = 0;                                  // The queues with records waiting.
+      if (findUrgent(HydroMonitorUploadScheduler::QUEUE_ERRORS)) {
+        bitSet(pending, HydroMonitorUploadScheduler::QUEUE_ERRORS);
       }
-      else if (messageTransmitComplete == false) {          // We have messages to transmit.
-        Serial.println(F("Going to transmit message."));
-        transmitMessages();
+      if (findUrgent(HydroMonitorUploadScheduler::QUEUE_WARNINGS)) {
+        bitSet(pending, HydroMonitorUploadScheduler::QUEUE_WARNINGS);
       }
+      if (dataTransmitComplete == false) {
+        bitSet(pending, HydroMonitorUploadScheduler::QUEUE_DATA);
+      }
+      if (messageTransmitComplete == false) {
+        bitSet(pending, HydroMonitorUploadScheduler::QUEUE_MESSAGES);
+      }
+      HydroMonitorUploadScheduler::UploadQueues queue = scheduler.next(pending);
+      switch (queue) {
+        case HydroMonitorUploadScheduler::QUEUE_ERRORS:     // Errors and warnings go ahead of the other records.
+        case HydroMonitorUploadScheduler::QUEUE_WARNINGS:
+          Serial.println(F("Going to transmit urgent message."));
+          transmitUrgent(queue);
+          break;
+
+        case HydroMonitorUploadScheduler::QUEUE_DATA:
+          if (batchSupported) {                             // Send pending data in batches, if the server supports that.
+            transmitBatch();
+          }
+          else {
+            Serial.print(F("Going to transmit sensor data point #"));
+            Serial.println(dataRecordToTransmit);
+            transmitData();
+          }
+          break;
+
+        case HydroMonitorUploadScheduler::QUEUE_MESSAGES:
+#ifdef LOG_BATCH_MESSAGES
+          if (batchSupported && dataTransmitComplete) {
+            transmitBatch();
+            break;
+          }
+#endif
+          Serial.println(F("Going to transmit message."));
+          transmitMessages();
+          break;
+
+        default:                                            // Nothing to send.
+          break;
+      }
+#endif
     }
   }
 }
 
 /********************************************************************************************************************
-   Transmit a sensor data record to the server.
+   Start the upload of a sensor data record to the server.
 */
 void HydroMonitorLogging::transmitData() {
-  File f = SPIFFS.open(dataLogFileName, "r+");              // Open log file for read/write.
 
-  // All data is stored already in the logfile; read back the data to transmit, attempt to transmit it, and if
-  // successful mark the record as transmitted.
+  // All data is stored already in the log; read back the data to transmit, attempt to transmit it, and if
+  // successful move the cursor past the record.
   HydroMonitorCore::SensorData dataEntry;
-  Serial.print(F("Sensor data record start byte: "));
-  Serial.print(dataRecordToTransmit * fileRecordSize);
-  Serial.print(F(", end byte: "));
-  Serial.print(dataRecordToTransmit * fileRecordSize + fileRecordSize);
-  Serial.print(F(", file size: "));
-  Serial.println(f.size());
-  f.seek(dataRecordToTransmit * fileRecordSize, SeekSet);   // Start reading from the start of the next record we have to transmit.
-  f.readBytes(buff, fileRecordSize);
+  HydroMonitorLogFile f = dataStore.open(&dataRecordToTransmit);           // Start reading from the start of the next record we have to transmit.
+  Serial.print(F("Sensor data record position: "));
+  Serial.print(dataRecordToTransmit);
+  Serial.print(F(", data log end: "));
+  Serial.println(dataStore.end());
   uint32_t timestamp;
-  memcpy(&timestamp, buff + 1, 4);                          // Skip the record's byte 0, the status byte.
-  memcpy(&dataEntry, buff + 16, dataRecordSize);            // Skip the record's 16-byte header.
-  uint16_t size = 150 + strlen(settings.hostname) + strlen(settings.hostpath) + strlen(settings.username) + strlen(settings.password);
-  char postData[size];
-  Serial.print(F("Sensor data postData buffer size: "));
-  Serial.println(size);
-  sprintf_P(postData, PSTR("http://%s%s?username=%s&password=%s&timestamp=%u"),
-            settings.hostname, settings.hostpath, settings.username, settings.password, timestamp);
-  char sensorDataBuff[20];
-#ifdef USE_EC_SENSOR
-  sprintf_P(sensorDataBuff, PSTR("&ec=%4.2f"), dataEntry.EC);
-  strcat(postData, sensorDataBuff);  
-#endif
-#ifdef USE_PH_SENSOR
-  sprintf_P(sensorDataBuff, PSTR("&ph=%4.2f"), dataEntry.pH);
-  strcat(postData, sensorDataBuff);  
-#endif
-#ifdef USE_WATERTEMPERATURE_SENSOR
-  sprintf_P(sensorDataBuff, PSTR("&watertemp=%4.2f"), dataEntry.waterTemp);
-  strcat(postData, sensorDataBuff);  
+  uint32_t sequence;
+  uint16_t recordSize = readDataRecord(&f, &timestamp, &dataEntry, &sequence);
+  f.close();
+  if (recordSize == 0) {                                    // Corrupt record: skip the rest of the segment.
+    dataTransmitted((dataRecordToTransmit / LOG_SEGMENT_SIZE + 1) * LOG_SEGMENT_SIZE);
+    return;
+  }
+  if (timestamp == 0) {                                     // Record we can't decode: skip it.
+    dataTransmitted(dataRecordToTransmit + recordSize);
+    return;
+  }
+  HydroMonitorQueryBuilder request(requestBuff, REQUEST_BUFFER_SIZE);
+  requestPath(&request, settings.hostpath, settings.username, settings.password);
+  dataFields(&request, sequence, timestamp, &dataEntry);
+  uploadDataEnd = dataRecordToTransmit + recordSize;
+  uploadMessageEnd = messageToTransmit;
+  startUpload(UPLOAD_DATA);
+}
+
+/********************************************************************************************************************
+   Whether the sensor data differs from the latest record stored: a channel moved by at least its deadband, or
+   (for FIELD_UINT32 channels) any bit changed.
+*/
+bool HydroMonitorLogging::dataChanged() {
+  for (uint8_t i = 0; i < sizeof(dataSchema) / sizeof(DataField); i++) {
+    const DataField* field = &dataSchema[i];
+    if (field->type == FIELD_UINT32) {
+      if (memcmp((const uint8_t*)sensorData + field->member, (const uint8_t*)&storedData + field->member, 4) != 0) {
+        return true;
+      }
+    }
+    else if (fabs(getField(field, sensorData) - getField(field, &storedData)) >= max(field->deadband, field->scale)) {
+      return true;
+    }
+  }
+  return false;
+}
+
+/********************************************************************************************************************
+   Store the sensor data as a new data record, and remember it to compare the next samples with.
+*/
+void HydroMonitorLogging::storeData() {
+  uint8_t dataRecord[fileRecordSize];
+  DataHeader* header = (DataHeader*)dataRecord;
+  memset(header, 0, sizeof(DataHeader));                    // Header, starting with all zeros.
+  header->status = RECORD_CHECKED;                          // It's merely stored at the moment.
+  header->timestamp = now();
+  header->schema = DATA_SCHEMA_PACKED;
+  header->size = dataRecordSize;
+  header->sequence = nextSequence();
+  packData(dataRecord + sizeof(DataHeader), sensorData);    // The sensor data.
+  sealRecord(dataRecord, fileRecordSize);
+  dataStore.append(dataRecord, fileRecordSize);
+  memcpy(&storedData, sensorData, sizeof(HydroMonitorCore::SensorData));
+  lastStored = millis();
+#if defined(LOG_SERIAL) && defined(SERIAL)
+  Serial.print(F("New sensor data point logged. Data log end: "));
+  Serial.println(dataStore.end());
 #endif
-#ifdef USE_WATERLEVEL_SENSOR
-  sprintf_P(sensorDataBuff, PSTR("&waterlevel=%4.2f"), dataEntry.waterLevel);
-  strcat(postData, sensorDataBuff);  
-#endif
-
-  uint16_t httpCode = sendPostData(postData);
-  if (httpCode == 200) {                                    // 200 = OK, transmissions successful.
-    uint16_t seekPointer = dataRecordToTransmit * fileRecordSize;
-    f.seek(dataRecordToTransmit * fileRecordSize, SeekSet);
-    f.write(RECORD_TRANSMITTED);                            // Mark file entry as transmitted.
-    dataRecordToTransmit++;                                 // Proceed to next entry.
-    if (f.size() == dataRecordToTransmit * fileRecordSize) {
-      dataTransmitComplete = true;
-      Serial.println(F("Sensor data transmission completed."));
-    }
-    else if (f.size() < dataRecordToTransmit * fileRecordSize) { // This should never happen, yet it does...
-      Serial.println(F("Data record file corrupt; creating a new one."));
-      Serial.print(F("Data file size: "));
-      Serial.print(f.size());
-      Serial.print(F(", expected size: "));
-      Serial.println(dataRecordToTransmit * fileRecordSize);
-      f.close();
-      SPIFFS.remove(dataLogFileName);
-      f = SPIFFS.open(dataLogFileName, "w");                // create a new one.
-      f.close();
-      dataRecordToTransmit = 0;
+  dataTransmitComplete = false;                             // We have a new record to transmit!
+}
+
+/********************************************************************************************************************
+   Pack the logged channels of data into body, as described by dataSchema.
+*/
+void HydroMonitorLogging::packData(uint8_t* body, HydroMonitorCore::SensorData* data) {
+  for (uint8_t i = 0; i < sizeof(dataSchema) / sizeof(DataField); i++) {
+    const DataField* field = &dataSchema[i];
+    uint32_t packed = packField(field, data);
+    memcpy(body, &packed, field->width);                    // Little endian: the low bytes.
+    body += field->width;
+  }
+}
+
+/********************************************************************************************************************
+   A channel of data as it's packed in a record: the number of steps of scale above zero, rounded, and limited to
+   what fits in the width of the field. FIELD_UINT32 channels as they are: a float can't hold all 32 bits.
+*/
+uint32_t HydroMonitorLogging::packField(const DataField* field, const HydroMonitorCore::SensorData* data) {
+  if (field->type == FIELD_UINT32) {
+    uint32_t packed;
+    memcpy(&packed, (const uint8_t*)data + field->member, 4);
+    return packed;
+  }
+  float value = getField(field, data);
+  uint32_t maxValue = (field->width == 4) ? 0xFFFFFFFF : (1ul << (8 * field->width)) - 1;
+  value = (value - field->zero) / field->scale + 0.5;       // Rounded to the nearest step.
+  return (value <= 0) ? 0 : (value >= maxValue) ? maxValue : (uint32_t)value;
+}
+
+/********************************************************************************************************************
+   Unpack a DATA_SCHEMA_PACKED record body into data. Channels that are not logged are left zero.
+*/
+void HydroMonitorLogging::unpackData(const uint8_t* body, HydroMonitorCore::SensorData* data) {
+  memset(data, 0, sizeof(HydroMonitorCore::SensorData));
+  for (uint8_t i = 0; i < sizeof(dataSchema) / sizeof(DataField); i++) {
+    const DataField* field = &dataSchema[i];
+    uint32_t packed = 0;
+    memcpy(&packed, body, field->width);
+    body += field->width;
+    unpackField(field, data, packed);
+  }
+}
+
+/********************************************************************************************************************
+   Set a channel of data to its packed value.
+*/
+void HydroMonitorLogging::unpackField(const DataField* field, HydroMonitorCore::SensorData* data, uint32_t packed) {
+  if (field->type == FIELD_UINT32) {
+    memcpy((uint8_t*)data + field->member, &packed, 4);
+  }
+  else {
+    setField(field, data, packed * field->scale + field->zero);
+  }
+}
+
+/********************************************************************************************************************
+   The value of a channel of data. Not for FIELD_UINT32 channels: a float can't hold all 32 bits.
+*/
+float HydroMonitorLogging::getField(const DataField* field, const HydroMonitorCore::SensorData* data) {
+  const uint8_t* member = (const uint8_t*)data + field->member;
+  switch (field->type) {
+    case FIELD_FLOAT:
+      return *(const float*)member;
+    case FIELD_INT32:
+      return *(const int32_t*)member;
+    case FIELD_UINT16:
+      return *(const uint16_t*)member;
+    case FIELD_BOOL:
+      return *(const bool*)member;
+    default:
+      return 0;
+  }
+}
+
+/********************************************************************************************************************
+   Set a channel of data to value. Not for FIELD_UINT32 channels.
+*/
+void HydroMonitorLogging::setField(const DataField* field, HydroMonitorCore::SensorData* data, float value) {
+  uint8_t* member = (uint8_t*)data + field->member;
+  switch (field->type) {
+    case FIELD_FLOAT:
+      *(float*)member = value;
+      break;
+    case FIELD_INT32:
+      *(int32_t*)member = round(value);
+      break;
+    case FIELD_UINT16:
+      *(uint16_t*)member = round(value);
+      break;
+    case FIELD_BOOL:
+      *(bool*)member = (value >= 0.5);
+      break;
+  }
+}
+
+/********************************************************************************************************************
+   Read the data record at the current position of f into timestamp and dataEntry.
+   Both the packed records and the older records holding a copy of SensorData (DATA_SCHEMA_RAW) are understood.
+   Returns the size of the record, or 0 if it's not a valid record. If the record can't be decoded (it was
+   written with another schema) timestamp is set to 0.
+*/
+uint16_t HydroMonitorLogging::readDataRecord(HydroMonitorLogFile* f, uint32_t* timestamp, HydroMonitorCore::SensorData* dataEntry,
+                                             uint32_t* sequence) {
+  DataHeader header;
+  if (f->read((uint8_t*)&header, sizeof(DataHeader)) != sizeof(DataHeader) || validStatus(header.status) == false) {
+    return 0;
+  }
+  *timestamp = header.timestamp;
+  if (sequence) {
+    *sequence = header.sequence;
+  }
+  if (header.schema == DATA_SCHEMA_RAW) {
+    f->read((uint8_t*)dataEntry, sizeof(HydroMonitorCore::SensorData));
+    return sizeof(DataHeader) + sizeof(HydroMonitorCore::SensorData);
+  }
+  if (f->read((uint8_t*)buff, header.size) != header.size ||
+      checkRecord((uint8_t*)&header, (uint8_t*)buff, header.size) == false) {
+    return 0;                                               // Torn or damaged record.
+  }
+  if (header.schema == DATA_SCHEMA_PACKED && header.size == dataRecordSize) {
+    unpackData((uint8_t*)buff, dataEntry);
+  }
+  else {
+    *timestamp = 0;
+  }
+  return sizeof(DataHeader) + header.size;
+}
+
+/********************************************************************************************************************
+   Add a sample to the running hourly and daily rollups. When a sample falls in a new period, the rollup of the
+   period that ended is stored first.
+*/
+void HydroMonitorLogging::addToRollups(uint32_t timestamp, HydroMonitorCore::SensorData* data) {
+  static_assert(sizeof(dataSchema) / sizeof(DataField) <= MAX_ROLLUP_FIELDS, "MAX_ROLLUP_FIELDS too small.");
+  for (uint8_t r = 0; r < ROLLUPS; r++) {
+    Rollup* roll = &rollup[r];
+    uint32_t start = timestamp - timestamp % rollupPeriod[r];
+    if (roll->count > 0 && roll->start != start) {          // A new period: store the one that ended.
+      writeRollup(r);
+    }
+    if (roll->count == 0) {
+      roll->start = start;
+      roll->minimum = *data;
+      roll->maximum = *data;
+      for (uint8_t i = 0; i < MAX_ROLLUP_FIELDS; i++) {
+        roll->sum[i] = 0;
+      }
+    }
+    for (uint8_t i = 0; i < sizeof(dataSchema) / sizeof(DataField); i++) {
+      const DataField* field = &dataSchema[i];
+      if (field->type == FIELD_UINT32) {                    // Bit fields: the bits set all the time, and those set at any time.
+        uint32_t value = *(const uint32_t*)((const uint8_t*)data + field->member);
+        *(uint32_t*)((uint8_t*)&roll->minimum + field->member) &= value;
+        *(uint32_t*)((uint8_t*)&roll->maximum + field->member) |= value;
+        continue;
+      }
+      float value = getField(field, data);
+      if (value < getField(field, &roll->minimum)) {
+        setField(field, &roll->minimum, value);
+      }
+      if (value > getField(field, &roll->maximum)) {
+        setField(field, &roll->maximum, value);
+      }
+      roll->sum[i] += value;
+    }
+    roll->latest = *data;
+    roll->count++;
+  }
+}
+
+/********************************************************************************************************************
+   Store rollup r as a DATA_SCHEMA_ROLLUP record, and start over.
+*/
+void HydroMonitorLogging::writeRollup(uint8_t r) {
+  Rollup* roll = &rollup[r];
+  uint8_t rollupRecord[sizeof(DataHeader) + rollupRecordSize];
+  DataHeader* header = (DataHeader*)rollupRecord;
+  memset(header, 0, sizeof(DataHeader));
+  header->status = RECORD_CHECKED;
+  header->timestamp = roll->start;
+  header->schema = DATA_SCHEMA_ROLLUP;
+  header->size = rollupRecordSize;
+  HydroMonitorCore::SensorData mean = roll->latest;         // Bit fields keep their latest value.
+  for (uint8_t i = 0; i < sizeof(dataSchema) / sizeof(DataField); i++) {
+    if (dataSchema[i].type != FIELD_UINT32) {
+      setField(&dataSchema[i], &mean, roll->sum[i] / roll->count);
+    }
+  }
+  uint8_t* body = rollupRecord + sizeof(DataHeader);
+  packData(body, &roll->minimum);
+  packData(body + dataRecordSize, &roll->maximum);
+  packData(body + 2 * dataRecordSize, &mean);
+  memcpy(body + 3 * dataRecordSize, &roll->count, 2);
+  sealRecord(rollupRecord, sizeof(rollupRecord));
+  rollupStore[r].append(rollupRecord, sizeof(rollupRecord));
+  roll->count = 0;
+}
+
+/********************************************************************************************************************
+   Read the rollup record at the current position of f: the minimum, maximum and mean in values[0], values[1] and
+   values[2], the number of samples in count.
+   Returns the size of the record, or 0 if it's not a valid record. If the record can't be decoded (it was
+   written with another schema) timestamp is set to 0.
+*/
+uint16_t HydroMonitorLogging::readRollupRecord(HydroMonitorLogFile* f, uint32_t* timestamp, HydroMonitorCore::SensorData* values, uint16_t* count) {
+  DataHeader header;
+  if (f->read((uint8_t*)&header, sizeof(DataHeader)) != sizeof(DataHeader) || validStatus(header.status) == false ||
+      f->read((uint8_t*)buff, header.size) != header.size ||
+      checkRecord((uint8_t*)&header, (uint8_t*)buff, header.size) == false) {
+    return 0;
+  }
+  *timestamp = header.timestamp;
+  if (header.schema == DATA_SCHEMA_ROLLUP && header.size == rollupRecordSize) {
+    for (uint8_t i = 0; i < 3; i++) {
+      unpackData((uint8_t*)buff + i * dataRecordSize, &values[i]);
+    }
+    memcpy(count, buff + 3 * dataRecordSize, 2);
+  }
+  else {
+    *timestamp = 0;
+  }
+  return sizeof(DataHeader) + header.size;
+}
+
+/********************************************************************************************************************
+   The CRC32 (as used by zip and Ethernet) of size bytes of data. Pass the CRC of the preceding data as crc to
+   continue a calculation.
+*/
+uint32_t HydroMonitorLogging::crc32(const uint8_t* data, uint16_t size, uint32_t crc) {
+  crc = ~crc;
+  for (uint16_t i = 0; i < size; i++) {
+    crc ^= data[i];
+    for (uint8_t bit = 0; bit < 8; bit++) {
+      crc = (crc >> 1) ^ (0xEDB88320 & (0 - (crc & 1)));
+    }
+  }
+  return ~crc;
+}
+
+/********************************************************************************************************************
+   Whether status is the status byte of a record.
+*/
+bool HydroMonitorLogging::validStatus(uint8_t status) {
+  return status == RECORD_CHECKED || status == RECORD_STORED || status == RECORD_TRANSMITTED;
+}
+
+/********************************************************************************************************************
+   The CRC32 of a record: its 16-byte header, with the CRC bytes taken as zero, and the size bytes of body.
+*/
+uint32_t HydroMonitorLogging::recordCrc(const uint8_t* header, const uint8_t* body, uint16_t size) {
+  uint8_t copy[16];
+  memcpy(copy, header, sizeof(copy));
+  memset(copy + offsetof(DataHeader, crc), 0, sizeof(uint32_t));
+  return crc32(body, size, crc32(copy, sizeof(copy)));
+}
+
+/********************************************************************************************************************
+   Put the CRC32 in the header of the complete record of size bytes, before it's stored.
+*/
+void HydroMonitorLogging::sealRecord(uint8_t* record, uint16_t size) {
+  static_assert(offsetof(DataHeader, crc) == offsetof(MessageHeader, crc), "CRC must be at the same place in all records.");
+  uint32_t crc = recordCrc(record, record + 16, size - 16);
+  memcpy(record + offsetof(DataHeader, crc), &crc, sizeof(uint32_t));
+}
+
+/********************************************************************************************************************
+   Check a record read back: its header, and the size bytes of body. Records stored before the CRC was added
+   can't be checked, and are taken as they are.
+*/
+bool HydroMonitorLogging::checkRecord(const uint8_t* header, const uint8_t* body, uint16_t size) {
+  if (header[0] != RECORD_CHECKED) {
+    return true;
+  }
+  uint32_t crc;
+  memcpy(&crc, header + offsetof(DataHeader, crc), sizeof(uint32_t));
+  return crc == recordCrc(header, body, size);
+}
+
+/********************************************************************************************************************
+   Add the sensor data fields of a record to the query string, as seq=...&timestamp=...&ec=...
+   Returns false if they didn't all fit.
+*/
+bool HydroMonitorLogging::dataFields(HydroMonitorQueryBuilder* query, uint32_t sequence, uint32_t timestamp,
+                                     HydroMonitorCore::SensorData* dataEntry) {
+  if (validSequence(sequence)) {                            // Older records have none.
+    query->addParameter(PSTR("seq"), sequence);
+  }
+  query->addParameter(PSTR("timestamp"), timestamp);
+#ifdef USE_EC_SENSOR
+  query->addParameter(PSTR("ec"), dataEntry->EC, 2);
+#endif
+#ifdef USE_PH_SENSOR
+  query->addParameter(PSTR("ph"), dataEntry->pH, 2);
+#endif
+#ifdef USE_WATERTEMPERATURE_SENSOR
+  query->addParameter(PSTR("watertemp"), dataEntry->waterTemp, 2);
+#endif
+#ifdef USE_WATERLEVEL_SENSOR
+  query->addParameter(PSTR("waterlevel"), dataEntry->waterLevel, 2);
+#endif
+  return query->overflow() == false;
+}
+
+/********************************************************************************************************************
+   Advance the data cursor to position end, the first record not yet transmitted, and release the transmitted
+   records in the store. The caller stores the new cursor in the journal.
+*/
+void HydroMonitorLogging::dataTransmitted(uint32_t end) {
+  dataRecordToTransmit = dataStore.seek(end);               // Proceed to next entry.
+  dataStore.truncate(dataRecordToTransmit);
+  dataTransmitComplete = (dataRecordToTransmit == dataStore.end());
+  if (dataTransmitComplete) {
+    Serial.println(F("Sensor data transmission completed."));
+  }
+  else {
+    Serial.print(F("Data log end: "));
+    Serial.print(dataStore.end());
+    Serial.print(F(", next data point starts at: "));
+    Serial.println(dataRecordToTransmit);
+  }
+}
+
+/********************************************************************************************************************
+   Start the upload of a batch of data records - and if LOG_BATCH_MESSAGES is defined, messages - in a single
+   POST request.
+*/
+void HydroMonitorLogging::transmitBatch() {
+  HydroMonitorQueryBuilder request(requestBuff, REQUEST_BUFFER_SIZE);
+  requestPath(&request, settings.hostpath, settings.username, settings.password);
+  request.addParameter(PSTR("batch"), (uint32_t)1);
+  uint16_t pathLength = request.length() + 1;
+  HydroMonitorQueryBuilder body(requestBuff + pathLength, REQUEST_BUFFER_SIZE - pathLength); // The body follows the path in requestBuff.
+  uint8_t nRecords = 0;                                     // Records in this batch.
+
+  // Add as many pending data records as fit in the batch.
+  uint32_t dataEnd = dataRecordToTransmit;                  // Start of the first data record not in this batch.
+  HydroMonitorCore::SensorData dataEntry;
+  HydroMonitorLogFile f;
+  while (nRecords < batchSize) {
+    f = dataStore.open(&dataEnd);
+    if (!f) {                                               // No more data.
+      break;
+    }
+    uint32_t timestamp;
+    uint32_t sequence;
+    uint16_t recordSize = readDataRecord(&f, &timestamp, &dataEntry, &sequence);
+    f.close();
+    if (recordSize == 0) {                                  // Corrupt record: skip the rest of the segment.
+      dataEnd = (dataEnd / LOG_SEGMENT_SIZE + 1) * LOG_SEGMENT_SIZE;
+      continue;
+    }
+    if (timestamp == 0) {                                   // Record we can't decode: skip it.
+      dataEnd += recordSize;
+      continue;
+    }
+    uint16_t mark = body.mark();
+    body.addParameter(PSTR("type"), "data");
+    if (dataFields(&body, sequence, timestamp, &dataEntry) == false || body.add('\n') == false) { // Batch is full.
+      body.reset(mark);
+      break;
+    }
+    dataEnd += recordSize;
+    nRecords++;
+  }
+
+#ifdef LOG_BATCH_MESSAGES
+  // Fill up the rest of the batch with pending messages.
+  uint32_t messageEnd = messageToTransmit;                  // Start of the first message not in this batch.
+  while (nRecords < batchSize) {
+    f = messageStore.open(&messageEnd);
+    if (!f) {                                               // No more messages.
+      break;
+    }
+    uint16_t recordSize = readMessageRecord(&f);            // The control bytes and the message.
+    f.close();
+    if (recordSize == 0) {                                  // Corrupt record: skip the rest of the segment.
+      messageEnd = (messageEnd / LOG_SEGMENT_SIZE + 1) * LOG_SEGMENT_SIZE;
+      continue;
+    }
+    if (messageSent(messageEnd, control[1])) {              // Went ahead of the queue already.
+      messageEnd += recordSize;
+      continue;
+    }
+    uint16_t mark = body.mark();
+    body.addParameter(PSTR("type"), "message");
+    if (messageFields(&body, false) == false || body.add('\n') == false) { // Batch is full.
+      body.reset(mark);
+      break;
+    }
+    messageEnd += recordSize;                               // Proceed to next entry.
+    nRecords++;
+  }
+#endif
+
+  if (nRecords == 0) {                                      // First record is too big for a batch; send it by itself.
+    if (dataTransmitComplete == false) {
+      transmitData();
+    }
+    else {
+      transmitMessages();
+    }
+    return;
+  }
+
+  Serial.print(F("Batch upload of "));
+  Serial.print(nRecords);
+  Serial.println(F(" records."));
+  uploadDataEnd = dataEnd;
+#ifdef LOG_BATCH_MESSAGES
+  uploadMessageEnd = messageEnd;
+#else
+  uploadMessageEnd = messageToTransmit;
+#endif
+  uploadRecords = nRecords;
+  startUpload(UPLOAD_BATCH, body.c_str());
+}
+
+/********************************************************************************************************************
+   Start the request with the path, followed by the login details.
+*/
+void HydroMonitorLogging::requestPath(HydroMonitorQueryBuilder* request, const char* path, const char* un, const char* pw) {
+  request->add(path);
+  request->add('?');
+  request->addParameter(PSTR("username"), un);
+  request->addParameter(PSTR("password"), pw);
+}
+
+/********************************************************************************************************************
+   Start the upload of the request in requestBuff, with body (if any) as POST body. logData() takes it from here.
+*/
+void HydroMonitorLogging::startUpload(UploadTypes type, char* body) {
+  uploadBytes = strlen(requestBuff) + ((body) ? strlen(body) : 0);
+  uploadStarted = millis();
+  Serial.print(F("Starting transmission of "));
+  Serial.print(uploadBytes);
+  Serial.print(F(" bytes: "));
+  Serial.println(requestBuff);
+  connection.setHost(settings.hostname);
+  connection.start(requestBuff, body);
+  scheduler.requestStarted();
+  upload = type;
+}
+
+/********************************************************************************************************************
+   The upload in progress is complete, with responseCode as result: move the cursors past the records that were
+   received by the server.
+*/
+void HydroMonitorLogging::uploadFinished(int16_t responseCode) {
+  reportTiming(responseCode);
+  UploadTypes type = upload;
+  upload = UPLOAD_NONE;
+  if (type == UPLOAD_VALIDATE) {                            // Not an upload: no records, and no scheduler.
+    credentialsChecked(responseCode);
+    return;
+  }
+  if (responseCode == 200) {                                // 200 = OK, transmissions successful.
+    if (uploadDataEnd > dataRecordToTransmit) {
+      dataTransmitted(uploadDataEnd);
+    }
+    if (uploadMessageEnd > messageToTransmit) {
+      messagesTransmitted(uploadMessageEnd);
+    }
+    if (type == UPLOAD_URGENT) {                            // Sent ahead of the queue: the message cursor stays.
+      urgentNext[uploadQueue] = uploadUrgentEnd;
+    }
+    writeCursor();                                          // One journal entry for the whole upload.
+  }
+  if (type == UPLOAD_BATCH) {
+    uint8_t nRecords = uploadRecords;
+    int16_t httpCode = responseCode;
+    if (httpCode == 200) {
+
+      // Adapt the batch size to the response time: grow while the server keeps up, back off when it slows down.
+      if (responseTime < BATCH_TARGET_LATENCY / 2 && nRecords == batchSize && batchSize < MAX_BATCH_SIZE) {
+        batchSize = min(MAX_BATCH_SIZE, (uint8_t)(batchSize + 2));
+      }
+      else if (responseTime > BATCH_TARGET_LATENCY && batchSize > 1) {
+        batchSize /= 2;
+      }
+    }
+    else if (httpCode == 413) {                             // Request entity too large: try smaller batches.
+      batchSize = max((uint8_t)1, (uint8_t)(batchSize / 2));
+    }
+    else if (httpCode == 405 || httpCode == 501) {          // Server doesn't do batches.
+      writeTrace(LOG_MODULE_LOGGING, F("HydroMonitorLogging: server does not support batch uploads; sending records one by one."));
+      batchSupported = false;
+    }
+    else {                                                  // Connection failed: try again later.
+      if (batchSize > 1) {
+        batchSize /= 2;
+      }
+      scheduler.failure(responseCode);
+    }
+  }
+  else if (responseCode != 200) {                           // Connection failed: try again later.
+    scheduler.failure(responseCode);
+  }
+  if (responseCode == 200) {
+    scheduler.success((type == UPLOAD_BATCH) ? uploadRecords : 1, uploadBytes);
+    if (dataTransmitComplete && messageTransmitComplete) {
+      scheduler.drained();
+    }
+    Serial.print(F("Upload rate: "));
+    Serial.print(scheduler.uploadRate);
+    Serial.print(F(" requests/s, throughput: "));
+    Serial.print(scheduler.throughput);
+    Serial.println(F(" records/minute."));
+  }
+  else if (scheduler.retryDelay > 0) {
+    Serial.print(F("Upload failed; retrying in "));
+    Serial.print(scheduler.retryDelay / 1000);
+    Serial.println(F(" seconds."));
+  }
+}
+
+
+/********************************************************************************************************************
+   Start the upload of a message record to the server.
+*/
+void HydroMonitorLogging::transmitMessages() {
+  uint32_t position = messageToTransmit;
+  uint16_t recordSize;
+  while (true) {
+    HydroMonitorLogFile f = messageStore.open(&position);                  // Set seek pointer to start of the next message.
+    if (!f) {                                               // All remaining messages went ahead of the queue already.
+      messagesTransmitted(position);
+      writeCursor();
+      return;
+    }
+    recordSize = readMessageRecord(&f);                     // The control bytes and the message.
+    f.close();
+    if (recordSize == 0) {                                  // Corrupt record: skip the rest of the segment.
+      position = (position / LOG_SEGMENT_SIZE + 1) * LOG_SEGMENT_SIZE;
+    }
+    else if (messageSent(position, control[1])) {           // Sent ahead of the queue already: skip it.
+      position += recordSize;
+    }
+    else {
+      break;
+    }
+  }
+  HydroMonitorQueryBuilder request(requestBuff, REQUEST_BUFFER_SIZE);
+  requestPath(&request, settings.hostpath, settings.username, settings.password);
+  messageFields(&request, true);
+  uploadDataEnd = dataRecordToTransmit;
+  uploadMessageEnd = position + recordSize;
+  startUpload(UPLOAD_MESSAGE);
+}
+
+/********************************************************************************************************************
+   Start the upload of the next error or warning, ahead of the other records. findUrgent() located it.
+*/
+void HydroMonitorLogging::transmitUrgent(HydroMonitorUploadScheduler::UploadQueues queue) {
+  uint32_t position = urgentNext[queue];
+  HydroMonitorLogFile f = messageStore.open(&position);
+  uint16_t recordSize = readMessageRecord(&f);              // The control bytes and the message.
+  f.close();
+  if (recordSize == 0) {                                    // Corrupt record: skip the rest of the segment.
+    urgentNext[queue] = (position / LOG_SEGMENT_SIZE + 1) * LOG_SEGMENT_SIZE;
+    return;
+  }
+  HydroMonitorQueryBuilder request(requestBuff, REQUEST_BUFFER_SIZE);
+  requestPath(&request, settings.hostpath, settings.username, settings.password);
+  messageFields(&request, true);
+  uploadDataEnd = dataRecordToTransmit;                     // The cursors don't move.
+  uploadMessageEnd = messageToTransmit;
+  uploadQueue = queue;
+  uploadUrgentEnd = position + recordSize;
+  startUpload(UPLOAD_URGENT);
+}
+
+/********************************************************************************************************************
+   Look for the next message of queue (QUEUE_ERRORS or QUEUE_WARNINGS) that has not been sent yet, and leave
+   urgentNext[queue] at it. Only the messages after the previous one found are read, so each message is read
+   once.
+   Returns false if there is none.
+*/
+bool HydroMonitorLogging::findUrgent(HydroMonitorUploadScheduler::UploadQueues queue) {
+  uint32_t position = max(urgentNext[queue], messageToTransmit);
+  while (true) {
+    HydroMonitorLogFile f = messageStore.open(&position);
+    if (!f) {                                               // End of the log.
+      break;
+    }
+    uint16_t recordSize = readMessageRecord(&f, false);     // Only the level is needed.
+    f.close();
+    if (recordSize == 0) {                                  // Corrupt record: skip the rest of the segment.
+      position = (position / LOG_SEGMENT_SIZE + 1) * LOG_SEGMENT_SIZE;
+      continue;
+    }
+    if (messageQueue(control[1]) == queue) {
+      urgentNext[queue] = position;
+      return true;
+    }
+    position += recordSize;
+  }
+  urgentNext[queue] = position;
+  return false;
+}
+
+/********************************************************************************************************************
+   The priority queue a message of level goes in.
+*/
+HydroMonitorUploadScheduler::UploadQueues HydroMonitorLogging::messageQueue(uint8_t level) {
+  if (level <= LOG_ERROR) {
+    return HydroMonitorUploadScheduler::QUEUE_ERRORS;
+  }
+  if (level == LOG_WARNING) {
+    return HydroMonitorUploadScheduler::QUEUE_WARNINGS;
+  }
+  return HydroMonitorUploadScheduler::QUEUE_MESSAGES;
+}
+
+/********************************************************************************************************************
+   Whether the message of level at position was sent ahead of the queue already.
+*/
+bool HydroMonitorLogging::messageSent(uint32_t position, uint8_t level) {
+  HydroMonitorUploadScheduler::UploadQueues queue = messageQueue(level);
+  return queue != HydroMonitorUploadScheduler::QUEUE_MESSAGES && position < urgentNext[queue];
+}
+
+/********************************************************************************************************************
+   Add the fields of the message in control and buff to the query string. With partial set a message that is too
+   long is cut off; otherwise returns false if the fields didn't all fit.
+*/
+bool HydroMonitorLogging::messageFields(HydroMonitorQueryBuilder* query, bool partial) {
+  MessageHeader* header = (MessageHeader*)control;
+  if (validSequence(header->sequence)) {                    // Older records have none.
+    query->addParameter(PSTR("seq"), header->sequence);
+  }
+  query->addParameter(PSTR("loglevel"), (uint32_t)header->level);
+  query->addParameter(PSTR("timestamp"), header->timestamp);
+  query->addParameter(PSTR("message"), buff, partial);      // Last: if it's too long, it can be cut.
+  return query->overflow() == false;
+}
+
+/********************************************************************************************************************
+   The sequence number for a new record. When the reserved block is used up, the next block is reserved in EEPROM.
+*/
+uint32_t HydroMonitorLogging::nextSequence() {
+  if (sequence >= sequenceLimit) {
+    sequenceLimit = sequence + LOG_SEQUENCE_BLOCK;
+#ifdef USE_24LC256_EEPROM
+    sensorData->EEPROM->put(LOG_SEQUENCE_EEPROM, sequenceLimit);
+#else
+    EEPROM.put(LOG_SEQUENCE_EEPROM, sequenceLimit);
+    EEPROM.commit();
+#endif
+  }
+  return sequence++;
+}
+
+/********************************************************************************************************************
+   Whether a record has a sequence number: older data records have 0 in its place, older messages 0xFFFFFFFF.
+*/
+bool HydroMonitorLogging::validSequence(uint32_t sequence) {
+  return sequence != 0 && sequence != 0xFFFFFFFF;
+}
+
+/********************************************************************************************************************
+   Advance the message cursor to position end, the start of the first message not yet transmitted, and release the
+   transmitted messages in the store. The caller stores the new cursor in the journal.
+*/
+void HydroMonitorLogging::messagesTransmitted(uint32_t end) {
+  messageToTransmit = messageStore.seek(end);               // Proceed to next entry.
+  messageStore.truncate(messageToTransmit);
+  messageTransmitComplete = (messageToTransmit == messageStore.end());
+  urgentNext[HydroMonitorUploadScheduler::QUEUE_ERRORS] = max(urgentNext[HydroMonitorUploadScheduler::QUEUE_ERRORS], messageToTransmit);
+  urgentNext[HydroMonitorUploadScheduler::QUEUE_WARNINGS] = max(urgentNext[HydroMonitorUploadScheduler::QUEUE_WARNINGS], messageToTransmit);
+  if (messageTransmitComplete) {
+    Serial.println(F("Message transmission completed."));
+  }
+}
+
+#ifdef LOG_MQTT
+/********************************************************************************************************************
+   Open the connection to the MQTT broker. Publishing starts at the transmission cursors; logData() calls
+   publishRecords() from here on, as long as the connection is open.
+*/
+void HydroMonitorLogging::connectMqtt() {
+  publishDataNext = dataRecordToTransmit;
+  publishMessageNext = messageToTransmit;
+  firstPublication = 0;
+  nPublications = 0;
+  Serial.print(F("Connecting to MQTT broker "));
+  Serial.println(settings.hostname);
+  mqtt.setServer(settings.hostname, MQTT_PORT);
+  mqtt.setLogin(settings.username, settings.username, settings.password);
+  scheduler.requestStarted();
+  int16_t result = mqtt.connect();
+  if (result != CONNECTION_BUSY) {
+    scheduler.failure(result);
+  }
+}
+
+/********************************************************************************************************************
+   Handle the acknowledgements from the broker, and publish as many pending records as may be in flight.
+*/
+void HydroMonitorLogging::publishRecords() {
+  int16_t result = mqtt.poll();
+  if (loginValid != VALID && mqtt.ready()) {                // The broker accepted the login: the credentials check passed.
+    credentialsChecked(200);
+  }
+
+  // Move the cursors past the acknowledged records: the broker acknowledges in the order we published.
+  uint8_t n = mqtt.acknowledged();
+  if (n > 0) {
+    Publication* latest = &publication[(firstPublication + n - 1) % MQTT_MAX_IN_FLIGHT];
+    uint16_t bytes = 0;
+    for (uint8_t i = 0; i < n; i++) {
+      bytes += publication[(firstPublication + i) % MQTT_MAX_IN_FLIGHT].bytes;
+    }
+    if (latest->dataEnd > dataRecordToTransmit) {
+      dataTransmitted(latest->dataEnd);
+    }
+    if (latest->messageEnd > messageToTransmit) {
+      messagesTransmitted(latest->messageEnd);
+    }
+    writeCursor();                                          // One journal entry for all records acknowledged.
+    firstPublication = (firstPublication + n) % MQTT_MAX_IN_FLIGHT;
+    nPublications -= n;
+    scheduler.success(n, bytes);
+    if (dataTransmitComplete && messageTransmitComplete) {
+      scheduler.drained();
+    }
+  }
+  if (result != CONNECTION_BUSY) {                          // Connection lost: the records in flight are published again later.
+    Serial.print(F("MQTT connection closed: "));
+    Serial.println(result);
+    recordsRepublished += nPublications;
+    nPublications = 0;
+    if (result == MQTT_CONNECTION_REFUSED) {                // The credentials check: 4 and 5 are a bad login, like a 403.
+      credentialsChecked((mqtt.connackCode == 4 || mqtt.connackCode == 5) ? 403 : result);
+    }
+    scheduler.failure(result);
+    return;
+  }
+
+  // Data first, then messages, like the HTTP uploads.
+  while (mqtt.ready()) {
+    if (publishDataNext < dataStore.end()) {
+      if (publishData() == false) {
+        break;
+      }
+    }
+    else if (publishMessageNext < messageStore.end()) {
+      if (publishMessage() == false) {
+        break;
+      }
+    }
+    else {
+      break;
+    }
+  }
+}
+
+/********************************************************************************************************************
+   Publish the data record at publishDataNext, as JSON.
+   Returns false if it could not be sent.
+*/
+bool HydroMonitorLogging::publishData() {
+  HydroMonitorCore::SensorData dataEntry;
+  HydroMonitorLogFile f = dataStore.open(&publishDataNext);
+  if (!f) {                                                 // No more data.
+    return true;
+  }
+  uint32_t timestamp;
+  uint32_t sequence;
+  uint16_t recordSize = readDataRecord(&f, &timestamp, &dataEntry, &sequence);
+  f.close();
+  if (recordSize == 0) {                                    // Corrupt record: skip the rest of the segment.
+    publishDataNext = (publishDataNext / LOG_SEGMENT_SIZE + 1) * LOG_SEGMENT_SIZE;
+    return true;
+  }
+  if (timestamp == 0) {                                     // Record we can't decode: skip it.
+    publishDataNext += recordSize;
+    return true;
+  }
+  uint16_t length = sprintf_P(requestBuff, PSTR("{\"t\":%u"), timestamp);
+  if (validSequence(sequence)) {
+    length += sprintf_P(requestBuff + length, PSTR(",\"seq\":%u"), sequence);
+  }
+  for (uint8_t i = 0; i < sizeof(dataSchema) / sizeof(DataField); i++) {
+    length += sprintf_P(requestBuff + length, PSTR(",\"%s\":"), dataSchema[i].name);
+    length += fieldValue(requestBuff + length, &dataSchema[i], &dataEntry);
+  }
+  requestBuff[length++] = '}';
+  sprintf_P(topic, PSTR("hydromonitor/%s/data"), settings.username);
+  if (publish(length, publishDataNext + recordSize, publishMessageNext) == false) {
+    return false;
+  }
+  publishDataNext += recordSize;
+  return true;
+}
+
+/********************************************************************************************************************
+   Publish the message at publishMessageNext, as JSON.
+   Returns false if it could not be sent.
+*/
+bool HydroMonitorLogging::publishMessage() {
+  HydroMonitorLogFile f = messageStore.open(&publishMessageNext);
+  if (!f) {                                                 // No more messages.
+    return true;
+  }
+  uint16_t recordSize = readMessageRecord(&f);              // The control bytes and the message.
+  f.close();
+  if (recordSize == 0) {                                    // Corrupt record: skip the rest of the segment.
+    publishMessageNext = (publishMessageNext / LOG_SEGMENT_SIZE + 1) * LOG_SEGMENT_SIZE;
+    return true;
+  }
+  MessageHeader* header = (MessageHeader*)control;
+  uint16_t length = sprintf_P(requestBuff, PSTR("{\"t\":%u,"), header->timestamp);
+  if (validSequence(header->sequence)) {
+    length += sprintf_P(requestBuff + length, PSTR("\"seq\":%u,"), header->sequence);
+  }
+  length += sprintf_P(requestBuff + length, PSTR("\"l\":%u,\"m\":\""), header->level);
+  for (char* c = buff; *c && length < REQUEST_BUFFER_SIZE - 8; c++) { // JSON escape the message.
+    if (*c == '"' || *c == '\\') {
+      requestBuff[length++] = '\\';
+      requestBuff[length++] = *c;
+    }
+    else if ((uint8_t)*c < 0x20) {
+      length += sprintf_P(requestBuff + length, PSTR("\\u%04x"), *c);
     }
     else {
-      dataTransmitComplete = false;
-      Serial.print(F("File size: "));
-      Serial.print(f.size());
-      Serial.print(F(", next data point starts at: "));
-      Serial.println(dataRecordToTransmit * fileRecordSize);
+      requestBuff[length++] = *c;
     }
   }
-  else {                                                    // Connection failed: try again later.
-    connectionFailed = true;
-    connectionFailTime = millis();
+  requestBuff[length++] = '"';
+  requestBuff[length++] = '}';
+  sprintf_P(topic, PSTR("hydromonitor/%s/message"), settings.username);
+  if (publish(length, publishDataNext, publishMessageNext + recordSize) == false) {
+    return false;
   }
-  f.close();
-  lastSent = millis();
+  publishMessageNext += recordSize;
+  return true;
 }
 
 /********************************************************************************************************************
-   Transmit a message record to the server.
+   Publish the first length bytes of requestBuff on topic, and remember where the cursors go once the broker
+   acknowledges it: dataEnd and messageEnd.
 */
-void HydroMonitorLogging::transmitMessages() {
-  File f = SPIFFS.open(messageLogFileName, "r+");           // Open log file for read/write.
-  f.seek(messageToTransmit, SeekSet);                       // Set seek pointer to start of the next message.
-  f.readBytes(control, 16);                                 // The control bytes.
-  uint16_t nBytes = f.readBytesUntil('\0', buff, MAX_MESSAGE_SIZE); // The actual message.
-  buff[nBytes] = 0;                                         // Null terminator.
-  uint32_t timestamp;
-  memcpy(&timestamp, control + 2, 4);                       // The message's time stamp.
-  uint8_t loglevel = control[1];                            // The log level.
-  String encodedMessage = core.urlencode(buff);             // URLencode the message.
-  uint16_t size = 80 + strlen(settings.hostname) + strlen(settings.hostpath) + strlen(settings.username) + strlen(settings.password) + encodedMessage.length();
-  char postData[size];                                      // Create a buffer to hold the complete POST data.
-  char aLoglevel[2];
-  itoa(loglevel, aLoglevel, 10);
-  char aTimestamp[12];
-  ultoa(timestamp, aTimestamp, 10);
-  Serial.print(F("Message postData buffer size: "));
-  Serial.println(size);
-  sprintf_P(postData, PSTR("http://%s%s?username=%s&password=%s&loglevel=%s&message=%s&timestamp=%s"),
-            settings.hostname, settings.hostpath, settings.username, settings.password, aLoglevel, encodedMessage.c_str(), aTimestamp);
-  uint16_t httpCode = sendPostData(postData);               // Post the message to the database.
-  if (httpCode == 200) {                                    // 200 = OK, transmissions successful.
-    f.seek(messageToTransmit, SeekSet);                     // Set seek pointer back to the start of this message: the status byte.
-    f.write(RECORD_TRANSMITTED);                            // Mark file entry as transmitted.
-    messageToTransmit += nBytes + 17;                       // Proceed to next entry.
-    if (f.size() == messageToTransmit) {                    // We reached the end of the file - transmission completed.
-      messageTransmitComplete = true;
-      Serial.println(F("Message transmission completed."));
-    }
-    else if (f.size() < messageToTransmit) {                // This should never happen, yet it does...
-      Serial.println(F("Message record file corrupt; creating a new one."));
-      Serial.print(F("Message file size: "));
-      Serial.print(f.size());
-      Serial.print(F(", expected size: "));
-      Serial.println(messageToTransmit);
-      f.close();
-      SPIFFS.remove(messageLogFileName);
-      f = SPIFFS.open(messageLogFileName, "w");                // create a new one.
-      f.close();
-      messageToTransmit = 0;
-    }
+bool HydroMonitorLogging::publish(uint16_t length, uint32_t dataEnd, uint32_t messageEnd) {
+  if (mqtt.publish(topic, (const uint8_t*)requestBuff, length) == false) {
+    return false;
   }
-  else {                                                    // Connection failed: try again later.
-    connectionFailed = true;
-    connectionFailTime = millis();
-  }
-  f.close();
-  lastSent = millis();
+  Publication* p = &publication[(firstPublication + nPublications) % MQTT_MAX_IN_FLIGHT];
+  p->dataEnd = dataEnd;
+  p->messageEnd = messageEnd;
+  p->bytes = strlen(topic) + length;
+  nPublications++;
+  return true;
 }
+#endif
 
 /********************************************************************************************************************
-   Check a set of login credentials.
-
-   Returns true if valid; false if invalid.
+   Check the login credentials. This only starts the check: for HTTP logData() takes the validate request from
+   here like an upload, and credentialsChecked() handles the response; for MQTT the check is the CONNACK of the
+   connection to the broker (see publishRecords()). Until then hostValid, pathValid and loginValid are UNCHECKED.
 */
 void HydroMonitorLogging::checkCredentials() {
-  checkCredentials(settings.hostname, settings.hostpath, settings.username, settings.password);
-}
-
-void HydroMonitorLogging::checkCredentials(char* host, char* path, char* un, char* pw) {
   hostValid = UNCHECKED;
   pathValid = UNCHECKED;
   loginValid = UNCHECKED;
@@ -404,12 +1787,31 @@ void HydroMonitorLogging::checkCredentials(char* host, char* path, char* un, cha
   if (WiFi.status() != WL_CONNECTED) {
     return;
   }
+  if (upload != UPLOAD_NONE) {                              // Abandon the upload in progress; it's tried again later.
+    connection.stop();
+    upload = UPLOAD_NONE;
+  }
+
+#ifdef LOG_MQTT
+  connectMqtt();                                            // Anything in flight is published again.
+#else
+  HydroMonitorQueryBuilder request(requestBuff, REQUEST_BUFFER_SIZE); // No upload in progress: we can use its buffer.
+  requestPath(&request, settings.hostpath, settings.username, settings.password);
+  request.addParameter(PSTR("validate"), (uint32_t)1);
+  uploadStarted = millis();
+  Serial.print(F("Checking credentials: "));
+  Serial.println(requestBuff);
+  connection.setHost(settings.hostname);
+  connection.start(requestBuff);
+  upload = UPLOAD_VALIDATE;
+#endif
+}
 
-  uint16_t size = 35 + strlen(host) + strlen(path) + strlen(un) + strlen(pw);
-  char postData[size];
-  sprintf_P(postData, PSTR("http://%s%s?username=%s&password=%s&validate=1"),
-            host, path, un, pw);
-  uint16_t responseCode = sendPostData(postData);
+/********************************************************************************************************************
+   The validate request is complete, with responseCode as result. If the credentials were changed, the settings
+   are stored once the login is found valid.
+*/
+void HydroMonitorLogging::credentialsChecked(int16_t responseCode) {
   if (responseCode == 404) {
     hostValid = VALID;
     pathValid = INVALID;
@@ -424,6 +1826,17 @@ void HydroMonitorLogging::checkCredentials(char* host, char* path, char* un, cha
     pathValid = VALID;
     loginValid = VALID;
   }
+  if (loginValid == VALID && saveSettings) {
+#ifdef USE_24LC256_EEPROM
+    sensorData->EEPROM->put(LOGGING_EEPROM, settings);
+#else
+    EEPROM.put(LOGGING_EEPROM, settings);
+    EEPROM.commit();
+#endif
+  }
+  if (loginValid != UNCHECKED) {
+    saveSettings = false;
+  }
 }
 
 /********************************************************************************************************************
@@ -435,123 +1848,140 @@ void HydroMonitorLogging::writeLog(uint8_t loglevel) {
   Serial.println(buff);
 #endif
 
-  // Store message to the message log file.
-  File f = SPIFFS.open(messageLogFileName, "a");            // Open log file for appending.
-  addMessageToList(f.size());                               // New message starts at the end of the current file.
-  f.write(RECORD_STORED);                                   // Byte 0: message status.
-  f.write(loglevel);                                        // Byte 1: log level.
-  uint16_t size = strlen(buff) + 1;                         // Message size should include the null terminator.
-  uint32_t timestamp = now();
-
-  f.write(timestamp & 0xFF);                                // Bytes 2-5: the time stamp.
-  f.write(timestamp >> 8) & 0xFF;
-  f.write(timestamp >> 16) & 0xFF;
-  f.write(timestamp >> 24);
-
-  for (uint8_t i = 0; i < 10; i++) {                        // Bytes 6-15: reserved.
-    f.write(0xFF);
-  }
-  f.print(buff);                                            // Print the whole message to the file.
-  f.write(0);                                               // Add the null terminator to complete the record.
-  f.close();
+  // Store message in the message log.
+  MessageHeader* header = (MessageHeader*)control;
+  header->status = RECORD_CHECKED;
+  header->level = loglevel;
+  header->timestamp = now();
+  header->format = MESSAGE_TEXT;
+  header->size = 0xFF;
+  header->sequence = nextSequence();
+  sealRecord((uint8_t*)record, 16 + strlen(buff) + 1);
+  bufferMessage((uint8_t*)record, 16 + strlen(buff) + 1);   // Message includes the null terminator.
+}
 
-  // Check log file size, and if needed roll over into a new file. Copy latest 50 messages to the new log file.
-  File fOld = SPIFFS.open(messageLogFileName, "r");
-  if (fOld.size() > MAX_FILE_SIZE) {
-    Serial.println(fOld.size());
-    fOld.close();
-    if (SPIFFS.exists(messageLogFile1Name)) {               // Check on the rollover file; if it exists, remove it.
-      SPIFFS.remove(messageLogFile1Name);
-    }
-    SPIFFS.rename(messageLogFileName, messageLogFile1Name); // Rename the original log to the rollover file.
-    File fNew = SPIFFS.open(messageLogFileName, "w");       // Create a new logfile.
-    fOld = SPIFFS.open(messageLogFile1Name, "r");           // Open the old one for reading back the latest 50 messages.
-    uint32_t idx = latestMessageList[49];                   // Starting point of oldest message in the list is at index 49.
-    for (uint8_t i = 0; i < 50; i++) {
-      latestMessageList[i] -= idx;                          // Set the list to point to where the messages are going to be in the new file.
-    }
-    uint16_t bytesToRead = fOld.size() - idx;               // Calculate how many bytes we have to copy.
-    fOld.seek(idx, SeekSet);                                // Start copying from here.
-    while (idx < fOld.size() - MAX_MESSAGE_SIZE) {          // Copy MAX_MESSAGE_SIZE bytes at a time - that fits in buff - until less than that left in the file.
-      fOld.readBytes(buff, MAX_MESSAGE_SIZE);
-      fNew.write((uint8_t*)buff, MAX_MESSAGE_SIZE);
-      idx += MAX_MESSAGE_SIZE;
+/********************************************************************************************************************
+   Write a message from the catalogue to the message log: only its code and arguments are stored, the text is
+   formatted when the message is read back. Arguments that are not given (NAN) are not stored.
+*/
+void HydroMonitorLogging::writeCoded(uint8_t loglevel, uint8_t code, float arg0, float arg1) {
+  uint8_t messageRecord[sizeof(MessageHeader) + 1 + 2 * sizeof(float)];
+  MessageHeader* header = (MessageHeader*)messageRecord;
+  header->status = RECORD_CHECKED;
+  header->level = loglevel;
+  header->timestamp = now();
+  header->format = MESSAGE_CODED;
+  header->sequence = nextSequence();
+  uint8_t* body = messageRecord + sizeof(MessageHeader);
+  body[0] = code;
+  header->size = 1;
+  if (isnan(arg0) == false) {
+    memcpy(body + header->size, &arg0, sizeof(float));
+    header->size += sizeof(float);
+    if (isnan(arg1) == false) {
+      memcpy(body + header->size, &arg1, sizeof(float));
+      header->size += sizeof(float);
     }
-    uint16_t lastBytes = fOld.size() - idx;                 // Calculate the remainder of bytes to copy.
-    fOld.readBytes(buff, lastBytes);
-    fNew.write((uint8_t*)buff, lastBytes);
-    fNew.close();
   }
-  fOld.close();
-  messageTransmitComplete = false;                          // Because we just added a new one!
+  sealRecord(messageRecord, sizeof(MessageHeader) + header->size);
+  bufferMessage(messageRecord, sizeof(MessageHeader) + header->size);
+
+#if defined(LOG_SERIAL) && defined(SERIAL)
+  formatMessage(body, header->size);
+  Serial.println(buff);
+#endif
 }
 
 /********************************************************************************************************************
-   Trace level log messages.
+   Format a MESSAGE_CODED record body (code and arguments) into buff, using the message catalogue.
 */
-void HydroMonitorLogging::writeTrace(const char *str) {
-  if (LOGLEVEL >= LOG_TRACE) {
-    bufferMsg(str);
-    writeLog(LOG_TRACE);
+void HydroMonitorLogging::formatMessage(const uint8_t* body, uint8_t size) {
+  float args[2] = {0, 0};
+  memcpy(args, body + 1, min((uint8_t)(size - 1), (uint8_t)sizeof(args)));
+  uint8_t code = body[0];
+  if (code < sizeof(messageCatalogue) / sizeof(messageCatalogue[0])) {
+    snprintf_P(buff, MAX_MESSAGE_SIZE + 1, (PGM_P)pgm_read_ptr(&messageCatalogue[code]), args[0], args[1]);
+  }
+  else {                                                    // Logged by a newer firmware version.
+    sprintf_P(buff, PSTR("Message %u (not in catalogue): %.2f, %.2f."), code, args[0], args[1]);
   }
 }
 
-void HydroMonitorLogging::writeTrace(const __FlashStringHelper *str) {
-  if (LOGLEVEL >= LOG_TRACE) {
-    bufferMsg_P((PGM_P)str);
-    writeLog(LOG_TRACE);
+/********************************************************************************************************************
+   Read the message record at the current position of f: the header into control, and the message text into buff,
+   formatting it from the catalogue if needed. If format is not set, buff gets the body as stored.
+   Returns the size of the record, or 0 if it's not a valid record.
+*/
+uint16_t HydroMonitorLogging::readMessageRecord(HydroMonitorLogFile* f, bool format) {
+  if (f->readBytes(control, 16) != 16 || validStatus(control[0]) == false) {
+    return 0;
+  }
+  MessageHeader* header = (MessageHeader*)control;
+  if (header->format == MESSAGE_CODED) {
+    uint8_t body[1 + 2 * sizeof(float)];
+    uint8_t size = header->size;                            // Header is overwritten when formatting.
+    if (size == 0 || size > sizeof(body) || f->read(body, size) != size ||
+        checkRecord((uint8_t*)control, body, size) == false) {
+      return 0;
+    }
+    if (format) {
+      formatMessage(body, size);
+    }
+    else {                                                  // Raw code and arguments.
+      memcpy(buff, body, size);
+    }
+    return sizeof(MessageHeader) + size;
   }
+  uint16_t nBytes = f->readBytesUntil('\0', buff, MAX_MESSAGE_SIZE); // A plain text message.
+  buff[nBytes] = 0;
+  if (checkRecord((uint8_t*)control, (uint8_t*)buff, nBytes + 1) == false) {
+    return 0;
+  }
+  return sizeof(MessageHeader) + nBytes + 1;                // Including the null terminator.
 }
 
 /********************************************************************************************************************
-   Info level log messages.
+   Log a text message at level. The checks of the log level are done by the inline writeTrace() etc.
 */
-void HydroMonitorLogging::writeInfo(const char *str) {
-  if (LOGLEVEL >= LOG_INFO) {
-    bufferMsg(str);
-    writeLog(LOG_INFO);
-  }
+void HydroMonitorLogging::writeText(uint8_t level, const char* str) {
+  bufferMsg(str);
+  writeLog(level);
 }
 
-void HydroMonitorLogging::writeInfo(const __FlashStringHelper *str) {
-  if (LOGLEVEL >= LOG_INFO) {
-    bufferMsg_P((PGM_P)str);
-    writeLog(LOG_INFO);
-  }
+void HydroMonitorLogging::writeText_P(uint8_t level, PGM_P str) {
+  bufferMsg_P(str);
+  writeLog(level);
 }
 
 /********************************************************************************************************************
-   Warning level log messages.
+   Coded warnings and errors, logged if the level of the module the message belongs to allows.
 */
-void HydroMonitorLogging::writeWarning(const char *str) {
-  if (LOGLEVEL >= LOG_WARNING) {
-    bufferMsg(str);
-    writeLog(LOG_WARNING);
+void HydroMonitorLogging::writeWarning(uint8_t code, float arg0, float arg1) {
+  if (LOGLEVEL >= LOG_WARNING && logLevel[pgm_read_byte(&messageModule[code])] >= LOG_WARNING) {
+    writeCoded(LOG_WARNING, code, arg0, arg1);
   }
 }
 
-void HydroMonitorLogging::writeWarning(const __FlashStringHelper *str) {
-  if (LOGLEVEL >= LOG_WARNING) {
-    bufferMsg_P((PGM_P)str);
-    writeLog(LOG_WARNING);
+void HydroMonitorLogging::writeError(uint8_t code, float arg0, float arg1) {
+  if (LOGLEVEL >= LOG_ERROR && logLevel[pgm_read_byte(&messageModule[code])] >= LOG_ERROR) {
+    writeCoded(LOG_ERROR, code, arg0, arg1);
   }
 }
 
 /********************************************************************************************************************
-   Error level log messages.
+   Set the log level of module, and store it in EEPROM.
 */
-void HydroMonitorLogging::writeError(const char *str) {
-  if (LOGLEVEL >= LOG_ERROR) {
-    bufferMsg(str);
-    writeLog(LOG_ERROR);
-  }
-}
-
-void HydroMonitorLogging::writeError(const __FlashStringHelper *str) {
-  if (LOGLEVEL >= LOG_ERROR) {
-    bufferMsg_P((PGM_P)str);
-    writeLog(LOG_ERROR);
+void HydroMonitorLogging::setLogLevel(uint8_t module, uint8_t level) {
+  if (module >= LOG_MODULES || level < LOG_OFF || level > LOG_TRACE || logLevel[module] == level) {
+    return;
   }
+  logLevel[module] = level;
+#ifdef USE_24LC256_EEPROM
+  sensorData->EEPROM->put(LOG_LEVELS_EEPROM, logLevel);
+#else
+  EEPROM.put(LOG_LEVELS_EEPROM, logLevel);
+  EEPROM.commit();
+#endif
 }
 
 /********************************************************************************************************************
@@ -646,7 +2076,27 @@ void HydroMonitorLogging::settingsHtml(ESP8266WebServer *server) {
       </tr><tr>\n\
         <td></td>\n"));
   server->sendContent_P(PSTR("\
+      </tr><tr>\n\
+        <th colspan=\"2\">Log levels.</th>\n\
+      </tr>"));
+  char tmp[64];
+  for (uint8_t i = 0; i < LOG_MODULES; i++) {
+    server->sendContent_P(PSTR("<tr>\n\
+        <td>"));
+    server->sendContent_P((PGM_P)pgm_read_ptr(&logModuleNames[i]));
+    sprintf_P(tmp, PSTR(":</td>\n\
+        <td><select name=\"loglevel_%u\">"), i);
+    server->sendContent(tmp);
+    for (uint8_t level = LOG_OFF; level <= LOG_TRACE; level++) {
+      sprintf_P(tmp, PSTR("<option value=\"%u\"%s>"), level, (logLevel[i] == level) ? " selected" : "");
+      server->sendContent(tmp);
+      server->sendContent_P((level == LOG_TRACE) ? PSTR("Trace") : (level == LOG_INFO) ? PSTR("Info") :
+                            (level == LOG_WARNING) ? PSTR("Warning") : (level == LOG_ERROR) ? PSTR("Error") : PSTR("Off"));
+      server->sendContent_P(PSTR("</option>"));
+    }
+    server->sendContent_P(PSTR("</select></td>\n\
       </tr>"));
+  }
 }
 
 /********************************************************************************************************************
@@ -674,7 +2124,14 @@ bool HydroMonitorLogging::settingsJSON(ESP8266WebServer* server) {
   if (strlen(settings.password) > 0) {
     server->sendContent(settings.password);
   }
-  server->sendContent_P(PSTR("\"\n"
+  server->sendContent_P(PSTR("\",\n"
+                             "    \"loglevels\":["));
+  char tmp[64];
+  for (uint8_t i = 0; i < LOG_MODULES; i++) {
+    sprintf_P(tmp, (i == 0) ? PSTR("%u") : PSTR(",%u"), logLevel[i]);
+    server->sendContent(tmp);
+  }
+  server->sendContent_P(PSTR("]\n"
                              "  }"));
   return true;
 }
@@ -712,6 +2169,9 @@ void HydroMonitorLogging::updateSettings(ESP8266WebServer* server) {
         password[server->arg(i).length()] = '\0';
       }
     }
+    if (server->argName(i).startsWith("loglevel_")) {       // loglevel_<module>: the log level of that module.
+      setLogLevel(server->argName(i).substring(9).toInt(), server->arg(i).toInt());
+    }
   }
 
   // If nothing changed, just keep the original settings as is.
@@ -727,103 +2187,93 @@ void HydroMonitorLogging::updateSettings(ESP8266WebServer* server) {
   strcpy(settings.hostpath, hostpath);
   strcpy(settings.username, username);
   strcpy(settings.password, password);
+  batchSupported = true;                                    // New server may support batch uploads.
 
   // If any settings changed, check whether the login is valid. Only store the settings
-  // in EEPROM if the new credentials are correct.
+  // in EEPROM if the new credentials are correct: credentialsChecked() does that.
+  saveSettings = true;
   checkCredentials();
-  if (loginValid == VALID) {
-#ifdef USE_24LC256_EEPROM
-    sensorData->EEPROM->put(LOGGING_EEPROM, settings);
-#else
-    EEPROM.put(LOGGING_EEPROM, settings);
-    EEPROM.commit();
-#endif
-  }
 }
 
 /********************************************************************************************************************
-   Send out a GET request to post data.
+   Report the result and timing of the latest request.
 */
-uint16_t HydroMonitorLogging::sendPostData(char* postData) {
-
-  //  return 500;                                               // Disable the transmission of logging data for now.
-
-
-  //  std::unique_ptr<BearSSL::WiFiClientSecure>client(new BearSSL::WiFiClientSecure);
-  //  client.setInsecure();                                    // Do not check for https fingerprints (insecure: allows MiM attacks).
-
-  //  WiFiClientSecure client;
-  //  client.setInsecure();                                     // Do not check for https fingerprints (insecure: allows MiM attacks).
-  //  HTTPClient https;
-
-  WiFiClient client;
-  HTTPClient http;
-
-  // Open a connection to the host.
-  uint16_t responseCode;
-  uint32_t startTransmission = millis();
-  Serial.print(F("Starting transmission of "));
-  Serial.print(strlen(postData));
-  Serial.print(F(" bytes: "));
-  Serial.println(postData);
-  if (http.begin(client, postData)) {                       // HTTP connection.
-    Serial.println(F("Connected."));
-    responseCode = http.GET();                              // start connection and send HTTP header
-    Serial.println(F("Got the GET request result."));
-    if (responseCode > 0) {                                 // httpCode will be negative on error
-      if (responseCode == HTTP_CODE_OK || responseCode == HTTP_CODE_MOVED_PERMANENTLY) { // File found at server
-        String payload = http.getString();
-      }
-    }
-  }
-  http.end();
-  client.stop();
+void HydroMonitorLogging::reportTiming(int16_t responseCode) {
+  responseTime = connection.timing.connect + connection.timing.send + connection.timing.response;
   Serial.print(F("Transmission complete. Response code: "));
   Serial.print(responseCode);
-  Serial.print(F(" Time taken: "));
-  Serial.print(millis() - startTransmission);
+  Serial.print(F(" Time taken: connect "));
+  Serial.print(connection.timing.connect);
+  Serial.print(F(" ms, send "));
+  Serial.print(connection.timing.send);
+  Serial.print(F(" ms, response "));
+  Serial.print(connection.timing.response);
   Serial.println(F(" ms."));
-  return responseCode;
+#ifdef UPLOAD_TEST_LATENCY
+  responseTime = max(responseTime, millis() - uploadStarted); // Include the injected latency.
+#endif
 }
 
 /********************************************************************************************************************
-   When calling this function:
-   status: contains the message number requested (0 = latest, 49 = oldest); returns the message type (log level).
-   timestamp: returns the message's time stamp.
-   message: returns the actual message.
-   The function returns a reference to message for convenience.
+   Get message i (0 = the latest): the text in buff, its log level in level, and its time stamp in timestamp.
+   The latest messages come from the cache; older ones are looked up in the message index.
+   Returns false if the message is not available.
 */
-void HydroMonitorLogging::getLogMessage(uint8_t* status, uint32_t* timestamp) {
-  if (*status > 49) {                                       // We don't have that many messages available...
-    status = 0;
-    timestamp = 0;
-    strcpy(buff, "");
+bool HydroMonitorLogging::getLogMessage(uint32_t i, uint8_t* level, uint32_t* timestamp) {
+  buff[0] = 0;
+  if (i < messageCache.count()) {
+    HydroMonitorMessageCache::Entry entry;
+    uint16_t size = messageCache.get(i, &entry, (uint8_t*)buff);
+    *level = entry.level;
+    *timestamp = entry.timestamp;
+    if (entry.format == MESSAGE_CODED) {
+      uint8_t body[1 + 2 * sizeof(float)];
+      memcpy(body, buff, min(size, (uint16_t)sizeof(body)));
+      formatMessage(body, size);
+    }
+    return true;
   }
-  else {
-    File f = SPIFFS.open(messageLogFileName, "r");          // Open log file for reading.
-    f.seek(latestMessageList[*status] + 16, SeekSet);       // Set seek pointer to the start of the message.
-    uint16_t nBytes = f.readBytesUntil('\0', buff, MAX_MESSAGE_SIZE); // Copy the stored message into global buffer buff,
-    buff[nBytes] = 0;                                       // and top it off with a null terminator.
-    f.seek(latestMessageList[*status] + 1, SeekSet);        // Start reading control bytes from the start of the requested record; skip byte 0 (transmission status).
-    f.readBytes((char *)status, 1);                         // Byte 1: message type (log level).
-    f.readBytes((char *)timestamp, 4);                      // Byte 2-6: timestamp.
-    f.close();
+  if (i >= indexCount) {                                    // We don't have that many messages available...
+    return false;
   }
+  uint32_t position;
+  File f = LOG_FILESYSTEM.open(messageIndexFileName, "r");
+  f.seek((indexCount - 1 - i) * sizeof(uint32_t), SeekSet);
+  f.read((uint8_t*)&position, sizeof(uint32_t));
+  f.close();
+  uint32_t wanted = position;
+  HydroMonitorLogFile m = messageStore.open(&position);     // Open the segment holding the message.
+  bool found = (m && position == wanted && readMessageRecord(&m) > 0);
+  m.close();
+  if (found == false) {                                     // Message no longer available.
+    buff[0] = 0;
+    return false;
+  }
+  *level = control[1];                                      // Byte 1: message type (log level).
+  memcpy(timestamp, control + 2, 4);                        // Byte 2-5: timestamp.
+  return true;
 }
 
 
 /********************************************************************************************************************
    Read the latest 50 messages and transmit them as JSON object.
+   With the start argument older messages can be requested: start=50 gives messages 50-99, etc.
 */
 void HydroMonitorLogging::messagesJSON(ESP8266WebServer* server) {
+  uint32_t start = 0;
+  if (server->hasArg(F("start")) && core.isNumeric(server->arg(F("start")))) {
+    start = server->arg(F("start")).toInt();
+  }
   server->sendContent_P(PSTR("{\"messagelog\":\n"
                              "  {\n"));
   bool isFirst = true;
   uint8_t status;
   uint32_t timestamp;
-  for (uint8_t i = 0; i < 50; i++) {
-    status = i;
-    getLogMessage(&status, &timestamp);                     // Places the message in the global buff.
+  for (uint32_t i = start; i < start + 50; i++) {
+    if (getLogMessage(i, &status, &timestamp) == false) {   // Places the message in the global buff.
+      status = 0;
+      timestamp = 0;
+    }
     if (isFirst) {
       isFirst = false;
     }
@@ -842,7 +2292,584 @@ void HydroMonitorLogging::messagesJSON(ESP8266WebServer* server) {
     }
     server->sendContent_P(PSTR("\"]"));
   }
-  server->sendContent_P(PSTR("\n  }\n"
-                             "}"));
+  server->sendContent_P(PSTR("\n  },\n"
+                             "  \"messagecount\":"));
+  server->sendContent(itoa(indexCount, control, 10));
+  server->sendContent_P(PSTR("\n}"));
+}
+
+/********************************************************************************************************************
+   Add a sample of data to the history: each channel packed as in a data record, limited to 16 bits.
+*/
+void HydroMonitorLogging::addToHistory(uint32_t timestamp, HydroMonitorCore::SensorData* data) {
+  uint16_t sample[sizeof(dataSchema) / sizeof(DataField)];
+  for (uint8_t i = 0; i < sizeof(dataSchema) / sizeof(DataField); i++) {
+    const DataField* field = &dataSchema[i];
+    uint32_t packed = packField(field, data);
+    sample[i] = (field->type == FIELD_UINT32) ? packed & 0xFFFF : min(packed, (uint32_t)0xFFFF); // Bit fields: the low bits.
+  }
+  history.add(timestamp, sample);
+}
+
+/********************************************************************************************************************
+   Send the history of the last 24 hours, as JSON, in the format of dataQuery(): the names of the fields, and for
+   each sample the timestamp and the value of each channel. Nothing is read from the log.
+*/
+void HydroMonitorLogging::historyJSON(ESP8266WebServer* server) {
+  uint8_t nFields = sizeof(dataSchema) / sizeof(DataField);
+  char chunk[DATA_QUERY_CHUNK_SIZE];
+  uint16_t length = sprintf_P(chunk, PSTR("{\"interval\":%u,\"fields\":[\"timestamp\""), REFRESH_DATABASE / 1000);
+  for (uint8_t i = 0; i < nFields; i++) {
+    length += sprintf_P(chunk + length, PSTR(",\"%s\""), dataSchema[i].name);
+    if (length > DATA_QUERY_CHUNK_SIZE - DATA_QUERY_VALUE_SIZE) { // Chunk is full: send it.
+      server->sendContent(chunk);
+      length = 0;
+    }
+  }
+  length += sprintf_P(chunk + length, PSTR("],\n\"data\":["));
+  HydroMonitorCore::SensorData values;
+  memset(&values, 0, sizeof(HydroMonitorCore::SensorData));
+  for (uint8_t i = 0; i < history.count(); i++) {
+    length += sprintf_P(chunk + length, (i > 0) ? PSTR(",\n[%u") : PSTR("\n[%u"), history.timestamp(i));
+    for (uint8_t j = 0; j < nFields; j++) {
+      if (length > DATA_QUERY_CHUNK_SIZE - DATA_QUERY_VALUE_SIZE) { // Chunk is full: send it.
+        server->sendContent(chunk);
+        length = 0;
+      }
+      unpackField(&dataSchema[j], &values, history.value(i, j));
+      chunk[length] = ',';
+      length++;
+      length += fieldValue(chunk + length, &dataSchema[j], &values);
+    }
+    length += sprintf_P(chunk + length, PSTR("]"));
+  }
+  length += sprintf_P(chunk + length, PSTR("\n]}"));
+  server->sendContent(chunk);
+}
+
+/********************************************************************************************************************
+   Send the upload statistics, and the append time of the data log (us), as JSON.
+*/
+void HydroMonitorLogging::uploadStatsJSON(ESP8266WebServer* server) {
+  HydroMonitorUploadScheduler* s = &scheduler;
+  char str[60];
+  server->sendContent_P(PSTR("{\"uploadstats\":\n"
+                             "  {\n"));
+  sprintf_P(str, PSTR("    \"records\":%u,\n"), s->totalRecords);
+  server->sendContent(str);
+  sprintf_P(str, PSTR("    \"bytes\":%u,\n"), s->totalBytes);
+  server->sendContent(str);
+  sprintf_P(str, PSTR("    \"bytesperrecord\":%u,\n"), (s->totalRecords > 0) ? s->totalBytes / s->totalRecords : 0);
+  server->sendContent(str);
+  sprintf_P(str, PSTR("    \"throughput\":%u,\n"), s->throughput);
+  server->sendContent(str);
+  sprintf_P(str, PSTR("    \"uploadrate\":%.2f,\n"), s->uploadRate);
+  server->sendContent(str);
+  sprintf_P(str, PSTR("    \"responsetime\":%u,\n"), responseTime);
+  server->sendContent(str);
+  sprintf_P(str, PSTR("    \"drainrecords\":%u,\n"), s->drainRecords);
+  server->sendContent(str);
+  sprintf_P(str, PSTR("    \"draintime\":%u,\n"), s->drainTime);
+  server->sendContent(str);
+  sprintf_P(str, PSTR("    \"drainrate\":%.2f,\n"), (s->drainTime > 0) ? s->drainRecords * 1000.0 / s->drainTime : 0.0);
+  server->sendContent(str);
+  sprintf_P(str, PSTR("    \"failures\":%u,\n"), s->failures());
+  server->sendContent(str);
+  sprintf_P(str, PSTR("    \"recoverytime\":%u,\n"), s->recoveryTime);
+  server->sendContent(str);
+  sprintf_P(str, PSTR("    \"maxrecoverytime\":%u,\n"), s->maxRecoveryTime);
+  server->sendContent(str);
+  sprintf_P(str, PSTR("    \"messagesdropped\":%u,\n"), messagesDropped);
+  server->sendContent(str);
+  sprintf_P(str, PSTR("    \"recordssuppressed\":%u,\n"), recordsSuppressed);
+  server->sendContent(str);
+  sprintf_P(str, PSTR("    \"appendtime\":%u,\n"), dataStore.appendTime);
+  server->sendContent(str);
+  sprintf_P(str, PSTR("    \"maxappendtime\":%u,\n"), dataStore.maxAppendTime);
+  server->sendContent(str);
+#ifdef LOG_MQTT
+  sprintf_P(str, PSTR("    \"republished\":%u,\n"), recordsRepublished);
+  server->sendContent(str);
+#endif
+  sprintf_P(str, PSTR("    \"pending\":%s\n"), (dataTransmitComplete && messageTransmitComplete) ? "false" : "true");
+  server->sendContent(str);
+  server->sendContent_P(PSTR("  }\n}"));
+}
+
+#ifdef STORAGE_TEST_BENCHMARK
+/********************************************************************************************************************
+   Benchmark the log storages, and send the results as JSON. This blocks for seconds: no sensors, pumps or valves
+   are handled until it's done.
+*/
+void HydroMonitorLogging::storageBenchmarkJSON(ESP8266WebServer* server) {
+  server->sendContent_P(PSTR("{\"storagebenchmark\":\n"
+                             "  {\n"));
+  HydroMonitorFileLogStorage fileStorage(&LOG_FILESYSTEM);
+#ifdef LOG_LITTLEFS
+  benchmarkJSON(server, "littlefs", &fileStorage, benchmarkDirectory, false);
+#else
+  benchmarkJSON(server, "spiffs", &fileStorage, benchmarkDirectory, false);
+#endif
+#ifdef USE_24LC256_EEPROM
+  HydroMonitorEepromLogStorage eepromStorage(&eepromPages, EEPROM_BENCHMARK_START, EEPROM_BENCHMARK_SIZE);
+  benchmarkJSON(server, "eeprom", &eepromStorage, benchmarkDirectory, false);
+  HydroMonitorTieredLogStorage tieredStorage(&eepromStorage, &fileStorage);
+  benchmarkJSON(server, "tiered", &tieredStorage, benchmarkDirectory, false);
+#endif
+  uint32_t ramSize = 2 * LOG_SEGMENT_SIZE + SLOT_TABLE_ALIGN; // Room for two segments.
+  uint8_t* ram = new uint8_t[ramSize];
+  if (ram) {
+    HydroMonitorRamLogStorage ramStorage(ram, ramSize);
+    benchmarkJSON(server, "ram", &ramStorage, benchmarkDirectory, true);
+    delete[] ram;
+  }
+  else {                                                    // Not enough memory.
+    server->sendContent_P(PSTR("    \"ram\":null\n"));
+  }
+  server->sendContent_P(PSTR("  }\n}"));
+}
+
+/********************************************************************************************************************
+   Benchmark one storage, and send the result as JSON object name.
+*/
+void HydroMonitorLogging::benchmarkJSON(ESP8266WebServer* server, const char* name, HydroMonitorLogStorage* storage,
+                                        const char* dir, bool last) {
+  HydroMonitorLogBenchmark benchmark;
+  HydroMonitorLogBenchmark::Result result;
+  benchmark.run(storage, dir, fileRecordSize, &result);
+  char str[60];
+  sprintf_P(str, PSTR("    \"%s\":\n"
+                      "      {\n"), name);
+  server->sendContent(str);
+  sprintf_P(str, PSTR("        \"records\":%u,\n"), result.records);
+  server->sendContent(str);
+  sprintf_P(str, PSTR("        \"appendtime\":%u,\n"), result.appendTime);
+  server->sendContent(str);
+  sprintf_P(str, PSTR("        \"maxappendtime\":%u,\n"), result.maxAppendTime);
+  server->sendContent(str);
+  sprintf_P(str, PSTR("        \"rollovers\":%u,\n"), result.rollovers);
+  server->sendContent(str);
+  sprintf_P(str, PSTR("        \"rollovertime\":%u,\n"), result.rolloverTime);
+  server->sendContent(str);
+  sprintf_P(str, PSTR("        \"bytesperrecord\":%.1f,\n"), (float)result.bytesWritten / result.records);
+  server->sendContent(str);
+  sprintf_P(str, PSTR("        \"failed\":%s\n"), (result.failed) ? "true" : "false");
+  server->sendContent(str);
+  server->sendContent_P((last) ? PSTR("      }\n") : PSTR("      },\n"));
+}
+#endif
+
+/********************************************************************************************************************
+   Send the data records of a time range, as JSON or CSV. Arguments:
+   from, to: the time range (seconds since epoch); to defaults to now.
+   fields: comma separated list of the channels to include; all if not given.
+   format: json (default) or csv.
+*/
+void HydroMonitorLogging::dataQuery(ESP8266WebServer* server) {
+  uint32_t from = 0;
+  uint32_t to = now();
+  if (server->hasArg(F("from")) && core.isNumeric(server->arg(F("from")))) {
+    from = server->arg(F("from")).toInt();
+  }
+  if (server->hasArg(F("to")) && core.isNumeric(server->arg(F("to")))) {
+    to = server->arg(F("to")).toInt();
+  }
+  bool csv = (server->arg(F("format")) == F("csv"));
+
+  // Raw records, or one of the rollups.
+  HydroMonitorLogStore* store = &dataStore;
+  uint16_t recordSize = fileRecordSize;
+  bool rollups = false;
+  String resolution = server->arg(F("resolution"));
+  if (server->arg(F("log")) == F("hourly")) {               // As sent on by exportLog().
+    resolution = F("hour");
+  }
+  else if (server->arg(F("log")) == F("daily")) {
+    resolution = F("day");
+  }
+  if (resolution == F("hour") || resolution == F("day")) {
+    store = &rollupStore[(resolution == F("hour")) ? ROLLUP_HOURLY : ROLLUP_DAILY];
+    recordSize = sizeof(DataHeader) + rollupRecordSize;
+    rollups = true;
+  }
+
+  // The channels to send: one bit per dataSchema entry.
+  const uint8_t nFields = sizeof(dataSchema) / sizeof(DataField);
+  uint32_t selected = 0xFFFFFFFF;
+  if (server->hasArg(F("fields"))) {
+    String fields = ",";                                    // Names with commas around them, to match whole names only.
+    fields += server->arg(F("fields"));
+    fields += ",";
+    selected = 0;
+    char name[24];
+    for (uint8_t i = 0; i < nFields; i++) {
+      snprintf_P(name, sizeof(name), PSTR(",%s,"), dataSchema[i].name);
+      if (fields.indexOf(name) >= 0) {
+        selected |= (1ul << i);
+      }
+    }
+  }
+
+  server->sendHeader(F("Cache-Control"), F("no-cache, no-store, must-revalidate"));
+  server->sendHeader(F("Pragma"), F("no-cache"));
+  server->sendHeader(F("Expires"), F("-1"));
+  server->setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server->send(200, (csv) ? F("text/csv") : F("application/json"), F(""));
+
+  // The header: the names of the columns. Rollups have the number of samples, and the minimum, maximum and mean
+  // of each channel.
+  char chunk[DATA_QUERY_CHUNK_SIZE];
+  uint16_t length = sprintf_P(chunk, (csv) ? PSTR("timestamp") : PSTR("{\"fields\":[\"timestamp\""));
+  if (rollups) {
+    length += sprintf_P(chunk + length, (csv) ? PSTR(",count") : PSTR(",\"count\""));
+  }
+  for (uint8_t i = 0; i < nFields; i++) {
+    if (selected & (1ul << i)) {
+      if (rollups) {
+        length += sprintf_P(chunk + length, (csv) ? PSTR(",%s_min,%s_max,%s_mean") : PSTR(",\"%s_min\",\"%s_max\",\"%s_mean\""),
+                            dataSchema[i].name, dataSchema[i].name, dataSchema[i].name);
+      }
+      else {
+        length += sprintf_P(chunk + length, (csv) ? PSTR(",%s") : PSTR(",\"%s\""), dataSchema[i].name);
+      }
+      if (length > DATA_QUERY_CHUNK_SIZE - DATA_QUERY_VALUE_SIZE) { // Chunk is full: send it.
+        server->sendContent(chunk);
+        length = 0;
+      }
+    }
+  }
+  length += sprintf_P(chunk + length, (csv) ? PSTR("\n") : PSTR("],\n\"data\":["));
+
+  // The records.
+  uint32_t nRecords = 0;
+  uint32_t position = findRecord(store, recordSize, from);
+  HydroMonitorCore::SensorData values[3];                   // Raw records use only the first.
+  uint8_t nValues = (rollups) ? 3 : 1;
+  HydroMonitorLogFile f = store->open(&position);
+  while (f) {
+    f.seek(position % LOG_SEGMENT_SIZE, SeekSet);
+    uint32_t timestamp;
+    uint16_t count;
+    uint16_t size = (rollups) ? readRollupRecord(&f, &timestamp, values, &count) : readDataRecord(&f, &timestamp, values);
+    if (size == 0) {                                        // Corrupt record: skip the rest of the segment.
+      position = (position / LOG_SEGMENT_SIZE + 1) * LOG_SEGMENT_SIZE;
+    }
+    else {
+      position += size;
+      if (timestamp > to) {                                 // End of the range.
+        break;
+      }
+      if (timestamp >= from) {                              // Skips records we can't decode (timestamp 0) as well.
+        length += sprintf_P(chunk + length, (csv) ? PSTR("%u") : (nRecords > 0) ? PSTR(",\n[%u") : PSTR("\n[%u"), timestamp);
+        if (rollups) {
+          length += sprintf_P(chunk + length, PSTR(",%u"), count);
+        }
+        for (uint8_t i = 0; i < nFields; i++) {
+          if (selected & (1ul << i)) {
+            for (uint8_t j = 0; j < nValues; j++) {
+              if (length > DATA_QUERY_CHUNK_SIZE - DATA_QUERY_VALUE_SIZE) { // Chunk is full: send it.
+                server->sendContent(chunk);
+                length = 0;
+              }
+              chunk[length] = ',';
+              length++;
+              length += fieldValue(chunk + length, &dataSchema[i], &values[j]);
+            }
+          }
+        }
+        length += sprintf_P(chunk + length, (csv) ? PSTR("\n") : PSTR("]"));
+        nRecords++;
+      }
+    }
+    if (length > DATA_QUERY_CHUNK_SIZE - DATA_QUERY_VALUE_SIZE) { // Chunk is full: send it.
+      server->sendContent(chunk);
+      length = 0;
+    }
+    if (position % LOG_SEGMENT_SIZE >= f.size() ||
+        position % LOG_SEGMENT_SIZE == 0) {                 // End of the segment: continue in the next.
+      f.close();
+      f = store->open(&position);
+    }
+    yield();
+  }
+  f.close();
+  if (csv == false) {
+    length += sprintf_P(chunk + length, PSTR("\n]}"));
+  }
+  server->sendContent(chunk);
+  Serial.print(F("Data query: sent "));
+  Serial.print(nRecords);
+  Serial.println(F(" records."));
+}
+
+/********************************************************************************************************************
+   Download a complete log. Arguments:
+   log: data (default), messages, hourly or daily.
+   format: raw (default), or csv.
+*/
+void HydroMonitorLogging::exportLog(ESP8266WebServer* server) {
+  String log = server->arg(F("log"));
+  bool csv = (server->arg(F("format")) == F("csv"));
+  if (log == F("messages")) {
+    if (csv) {
+      exportMessages(server);
+    }
+    else {
+      exportRaw(server, &messageStore, "messagelog");
+    }
+  }
+  else if (csv) {                                           // dataQuery() reads the arguments itself.
+    dataQuery(server);
+  }
+  else if (log == F("hourly")) {
+    exportRaw(server, &rollupStore[ROLLUP_HOURLY], "hourlylog");
+  }
+  else if (log == F("daily")) {
+    exportRaw(server, &rollupStore[ROLLUP_DAILY], "dailylog");
+  }
+  else {
+    exportRaw(server, &dataStore, "datalog");
+  }
+}
+
+/********************************************************************************************************************
+   Send the segments of store back to back, as stored, or the part of it asked for in a Range header.
+   name: the file name to offer to the client.
+*/
+void HydroMonitorLogging::exportRaw(ESP8266WebServer* server, HydroMonitorLogStore* store, const char* name) {
+
+  // The size of the export is set now: records appended while it's sent are left for the next one.
+  uint32_t firstSegment = store->first() / LOG_SEGMENT_SIZE;
+  uint32_t lastSegment = store->headStart() / LOG_SEGMENT_SIZE;
+  uint32_t total = 0;
+  for (uint32_t segment = firstSegment; segment <= lastSegment; segment++) {
+    total += store->segmentLength(segment);
+  }
+
+  // The range: bytes=<from>- or bytes=<from>-<to>. Ignored if the oldest record changed since the ETag the client
+  // got (If-Range).
+  char etag[16];
+  sprintf_P(etag, PSTR("\"%u\""), store->first());
+  uint32_t from = 0;
+  uint32_t to = (total > 0) ? total - 1 : 0;
+  bool partial = false;
+  String range = server->header("Range");
+  if (range.startsWith("bytes=") && (server->hasHeader("If-Range") == false || server->header("If-Range") == etag)) {
+    int16_t dash = range.indexOf('-');
+    if (dash > 6 && core.isNumeric(range.substring(6, dash))) { // Suffix ranges (bytes=-<n>) are not supported.
+      from = range.substring(6, dash).toInt();
+      if (dash + 1 < (int16_t)range.length() && core.isNumeric(range.substring(dash + 1))) {
+        to = min(to, (uint32_t)range.substring(dash + 1).toInt());
+      }
+      partial = true;
+    }
+  }
+  char header[64];                                          // Value of a response header.
+  if (partial && (from >= total || from > to)) {
+    sprintf_P(header, PSTR("bytes */%u"), total);
+    server->sendHeader(F("Content-Range"), header);
+    server->send(416, F("text/plain"), F(""));
+    return;
+  }
+  uint32_t length = (total > 0) ? to - from + 1 : 0;
+
+  server->sendHeader(F("Accept-Ranges"), F("bytes"));
+  server->sendHeader(F("ETag"), etag);
+  server->sendHeader(F("Cache-Control"), F("no-cache"));
+  snprintf_P(header, sizeof(header), PSTR("attachment; filename=\"%s\""), name);
+  server->sendHeader(F("Content-Disposition"), header);
+  if (partial) {
+    sprintf_P(header, PSTR("bytes %u-%u/%u"), from, to, total);
+    server->sendHeader(F("Content-Range"), header);
+  }
+  server->setContentLength(length);
+  server->send((partial) ? 206 : 200, F("application/octet-stream"), F(""));
+
+  // The segments, read and sent in chunks.
+  char chunk[DATA_QUERY_CHUNK_SIZE];
+  uint32_t offset = 0;                                      // Offset of the segment in the export.
+  uint32_t sent = 0;
+  for (uint32_t segment = firstSegment; segment <= lastSegment && length > 0; segment++) {
+    uint16_t segmentLength = store->segmentLength(segment);
+    if (from >= offset + segmentLength) {                   // Before the range.
+      offset += segmentLength;
+      continue;
+    }
+    uint32_t position = segment * LOG_SEGMENT_SIZE + from - offset;
+    uint32_t wanted = position;
+    HydroMonitorLogFile f = store->open(&position);
+    if (!f || position != wanted) {                         // The segment was removed: the client has to start over.
+      f.close();
+      break;
+    }
+    uint32_t n = min(length, offset + segmentLength - from);
+    while (n > 0) {
+      uint16_t size = f.read((uint8_t*)chunk, min(n, (uint32_t)sizeof(chunk)));
+      if (size == 0) {                                      // Read error: the client gets a short response, and can resume.
+        break;
+      }
+      server->sendContent(chunk, size);
+      n -= size;
+      from += size;
+      length -= size;
+      sent += size;
+      yield();
+    }
+    f.close();
+    if (n > 0) {
+      break;
+    }
+    offset += segmentLength;
+  }
+  Serial.print(F("Log export: sent "));
+  Serial.print(sent);
+  Serial.println(F(" bytes."));
+}
+
+/********************************************************************************************************************
+   Send the messages as CSV: position, timestamp, log level and the text. Argument start: the position to start at.
+*/
+void HydroMonitorLogging::exportMessages(ESP8266WebServer* server) {
+  uint32_t start = 0;
+  if (server->hasArg(F("start")) && core.isNumeric(server->arg(F("start")))) {
+    start = server->arg(F("start")).toInt();
+  }
+  server->sendHeader(F("Cache-Control"), F("no-cache, no-store, must-revalidate"));
+  server->sendHeader(F("Content-Disposition"), F("attachment; filename=\"messagelog.csv\""));
+  server->setContentLength(CONTENT_LENGTH_UNKNOWN);
+  server->send(200, F("text/csv"), F(""));
+
+  // Records are found by walking the segment from its start; start needn't be the position of a record.
+  char chunk[DATA_QUERY_CHUNK_SIZE];
+  uint16_t length = sprintf_P(chunk, PSTR("position,timestamp,level,message\n"));
+  uint32_t nMessages = 0;
+  uint32_t position = start / LOG_SEGMENT_SIZE * LOG_SEGMENT_SIZE;
+  HydroMonitorLogFile f = messageStore.open(&position);
+  while (f) {
+    f.seek(position % LOG_SEGMENT_SIZE, SeekSet);
+    uint16_t size = readMessageRecord(&f);                  // The control bytes and the message.
+    if (size == 0) {                                        // Corrupt record: skip the rest of the segment.
+      position = (position / LOG_SEGMENT_SIZE + 1) * LOG_SEGMENT_SIZE;
+    }
+    else {
+      if (position >= start) {
+        uint32_t timestamp;
+        memcpy(&timestamp, control + 2, 4);                 // The message's time stamp.
+        length += sprintf_P(chunk + length, PSTR("%u,%u,%u,\""), position, timestamp, control[1]);
+        for (char* c = buff; *c; c++) {                     // The text, quoted.
+          if (length > DATA_QUERY_CHUNK_SIZE - 4) {         // Chunk is full: send it.
+            server->sendContent(chunk, length);
+            length = 0;
+          }
+          if (*c == '"') {
+            chunk[length++] = '"';
+          }
+          chunk[length++] = *c;
+        }
+        chunk[length++] = '"';
+        chunk[length++] = '\n';
+        nMessages++;
+      }
+      position += size;
+    }
+    if (length > DATA_QUERY_CHUNK_SIZE - DATA_QUERY_VALUE_SIZE) { // Chunk is full: send it.
+      server->sendContent(chunk, length);
+      length = 0;
+    }
+    if (position % LOG_SEGMENT_SIZE >= f.size() ||
+        position % LOG_SEGMENT_SIZE == 0) {                 // End of the segment: continue in the next.
+      f.close();
+      f = messageStore.open(&position);
+    }
+    yield();
+  }
+  f.close();
+  if (length > 0) {
+    server->sendContent(chunk, length);
+  }
+  Serial.print(F("Message export: sent "));
+  Serial.print(nMessages);
+  Serial.println(F(" messages."));
+}
+
+/********************************************************************************************************************
+   Find the first record in store with a timestamp at or after time. All records in the store have the size
+   recordSize, and start with a DataHeader.
+   Returns its position, or store->end() if there is none.
+*/
+uint32_t HydroMonitorLogging::findRecord(HydroMonitorLogStore* store, uint16_t recordSize, uint32_t time) {
+
+  // The first segment that starts at or after time.
+  uint32_t firstSegment = store->first() / LOG_SEGMENT_SIZE;
+  uint32_t low = firstSegment;
+  uint32_t high = store->end() / LOG_SEGMENT_SIZE + 1;
+  while (low < high) {
+    uint32_t middle = low + (high - low) / 2;
+    if (recordTimestamp(store, middle * LOG_SEGMENT_SIZE) < time) {
+      low = middle + 1;
+    }
+    else {
+      high = middle;
+    }
+  }
+  uint32_t position = low * LOG_SEGMENT_SIZE;
+
+  // The record we look for is in the segment before it, or it's the first record of that segment.
+  if (low > firstSegment) {
+    uint32_t segment = (low - 1) * LOG_SEGMENT_SIZE;
+    uint32_t start = segment;
+    HydroMonitorLogFile f = store->open(&start);
+    uint16_t nRecords = (start == segment) ? f.size() / recordSize : 0;
+    f.close();
+    uint16_t first = 0;
+    uint16_t last = nRecords;
+    while (first < last) {
+      uint16_t middle = first + (last - first) / 2;
+      if (recordTimestamp(store, segment + middle * recordSize) < time) {
+        first = middle + 1;
+      }
+      else {
+        last = middle;
+      }
+    }
+    if (first < nRecords) {
+      position = segment + first * recordSize;
+    }
+  }
+  return store->seek(position);
+}
+
+/********************************************************************************************************************
+   The timestamp of the record at position in store; 0xFFFFFFFF if there is no record there.
+*/
+uint32_t HydroMonitorLogging::recordTimestamp(HydroMonitorLogStore* store, uint32_t position) {
+  uint32_t start = position;
+  HydroMonitorLogFile f = store->open(&start);
+  DataHeader header;
+  bool found = (f && start == position && f.read((uint8_t*)&header, sizeof(DataHeader)) == sizeof(DataHeader));
+  f.close();
+  return (found) ? header.timestamp : 0xFFFFFFFF;
+}
+
+/********************************************************************************************************************
+   Print the value of a channel of dataEntry in str, with as many decimals as it's stored with.
+   Returns the number of characters printed.
+*/
+uint8_t HydroMonitorLogging::fieldValue(char* str, const DataField* field, HydroMonitorCore::SensorData* dataEntry) {
+  const uint8_t* member = (const uint8_t*)dataEntry + field->member;
+  switch (field->type) {
+    case FIELD_FLOAT: {
+      uint8_t decimals = (field->scale >= 1) ? 0 : (field->scale >= 0.1) ? 1 : (field->scale >= 0.01) ? 2 : 3;
+      return sprintf_P(str, PSTR("%.*f"), decimals, *(const float*)member);
+    }
+    case FIELD_INT32:
+      return sprintf_P(str, PSTR("%d"), *(const int32_t*)member);
+    case FIELD_UINT16:
+      return sprintf_P(str, PSTR("%u"), *(const uint16_t*)member);
+    case FIELD_BOOL:
+      return sprintf_P(str, PSTR("%u"), *(const bool*)member);
+    default:                                                // FIELD_UINT32.
+      return sprintf_P(str, PSTR("%u"), *(const uint32_t*)member);
+  }
 }
 
@@ -1,25 +1,49 @@
 /*
    HydroMonitorLogging
 
+   Data and messages are stored in circular logs of segment files (see HydroMonitorLogStore.h): /dl/ and /ml/, and
+   the hourly and daily rollups in /rh/ and /rd/. Records are addressed by their position in the store; which have
+   been transmitted is kept in the cursor journal (or with USE_24LC256_EEPROM in the external EEPROM).
 
-  All log entries have a 16-byte header to store metadata, followed by the log entry itself.
+   All log entries have a 16-byte header to store metadata, followed by the log entry itself.
 
    Message file format:
-    - byte 0: records whether that record has been sent already.
-    - byte 1: message type (log level).
-    - byte 2-5: timestamp (seconds since epoch)
-    - byte 6-15: reserved for future use.
-    - byte 16 - n+16: the message itself in ASCII format, null terminated.
+     - byte 0: record status (RECORD_CHECKED; older records RECORD_STORED or RECORD_TRANSMITTED).
+     - byte 1: message type (log level).
+     - byte 2-5: timestamp (seconds since epoch)
+     - byte 6: format: MESSAGE_TEXT (0xFF), or MESSAGE_CODED.
+     - byte 7: size of the message body (MESSAGE_CODED only).
+     - byte 8-11: CRC32 of the record (RECORD_CHECKED only).
+     - byte 12-15: sequence number; 0xFFFFFFFF in older records.
+     - byte 16 - n+16: MESSAGE_TEXT: the message itself in ASCII format, null terminated.
+                       MESSAGE_CODED: the message code (1 byte), followed by up to two float arguments.
 
-    Minimum record size: 17; maximum record size: 516.
+     Minimum record size: 17; maximum record size: 516.
 
-    Data file format:
-      - byte 0: records whether that record has been sent already.
-      - byte 1-4: timestamp (seconds since epoch).
-      - byte 6-15: reserved for future use.
-      - byte 16 onwards: the sensor data.
+   Data file format:
+     - byte 0: record status (RECORD_CHECKED; older records RECORD_STORED or RECORD_TRANSMITTED).
+     - byte 1-4: timestamp (seconds since epoch).
+     - byte 5: unused.
+     - byte 6: schema: DATA_SCHEMA_PACKED or DATA_SCHEMA_ROLLUP, or DATA_SCHEMA_RAW (0) in older records.
+     - byte 7: size of the sensor data (packed records only).
+     - byte 8-11: CRC32 of the record (RECORD_CHECKED only).
+     - byte 12-15: sequence number; 0 in older records.
+     - byte 16 onwards: the sensor data, packed as in the dataSchema table in HydroMonitorLogging.cpp.
 
-    All data records have a fixed length of 16 + sizeOf(sensorData).
+   The CRC32 is calculated over the complete record with the CRC bytes set to zero. All records of a store have
+   the same size, and are stored in time order.
+
+   Records are uploaded in the background: each call to logData() does a bit more work on the upload, by HTTP
+   (single GET requests or batch POST requests) or with LOG_MQTT defined to an MQTT broker (QoS 1). The server
+   may receive a record twice; the user name and the sequence number identify it.
+
+   exportLog() honours HTTP Range requests only if the sketch calls server.collectHeaders() with Range and If-Range.
+
+   For testing only, a board may define UPLOAD_TEST_LATENCY (ms) to hold back every HTTP response, and
+   UPLOAD_TEST_FAILURES (0-100) to turn that percentage of the completed uploads into failures.
+   STORAGE_TEST_BENCHMARK adds storageBenchmarkJSON(), which benchmarks the log storages (see
+   HydroMonitorLogBenchmark.h). It blocks for seconds, so nothing else is handled meanwhile, and every run wears
+   the Flash and the EEPROM.
 
 */
 
@@ -28,21 +52,111 @@
 
 #include <HydroMonitorCore.h>
 #include <FS.h>
-#include <ESP8266HTTPClient.h>
+#include <HydroMonitorConnection.h>
+#include <HydroMonitorLogStore.h>
+#include <HydroMonitorFileLogStorage.h>
+#include <HydroMonitorRamLogStorage.h>
+#include <HydroMonitorEepromLogStorage.h>
+#include <HydroMonitorTieredLogStorage.h>
+#ifdef STORAGE_TEST_BENCHMARK
+#include <HydroMonitorLogBenchmark.h>
+#endif
+#ifdef LOG_LITTLEFS
+#include <LittleFS.h>
+#define LOG_FILESYSTEM LittleFS
+#else
+#define LOG_FILESYSTEM SPIFFS
+#endif
+#include <HydroMonitorMessageCache.h>
+#include <HydroMonitorHistory.h>
+#include <HydroMonitorQueryBuilder.h>
+#include <HydroMonitorUploadScheduler.h>
+#ifdef LOG_MQTT
+#include <HydroMonitorMqtt.h>
+#endif
 #include <WiFiClientSecure.h>
 #include <ESP8266WiFi.h>
 
 //#define RECORD_STATUS_SENT_BIT            0
 //#define RECORD_STATUS_EMAILED_BIT         1
 
-const uint16_t CONNECTION_RETRY_DELAY = 60 * 60 * 1000ul;
+const uint8_t FAILURES_BEFORE_WARNING = 3;                  // Consecutive failed uploads before we warn about it.
+
+// Batch upload settings.
+const uint16_t REQUEST_BUFFER_SIZE = 1280;                  // Size of the request buffer: path and POST body.
+const uint8_t MAX_BATCH_SIZE = 50;                          // Maximum number of records per batch.
+const uint16_t BATCH_TARGET_LATENCY = 2000;                 // Grow the batch while the response comes in faster than this (ms).
+
+// MQTT settings.
+const uint16_t MQTT_PORT = 1883;                            // Port of the MQTT broker.
+
+// Data queries.
+const uint16_t DATA_QUERY_CHUNK_SIZE = 512;                 // Size of the chunks a data query is sent in.
+const uint8_t DATA_QUERY_VALUE_SIZE = 64;                   // Room to keep in a chunk for the next value or column name.
+
+// Adaptive data logging.
+const uint32_t LOG_SAMPLE_INTERVAL = 60 * 1000ul;           // Check the sensor data for changes this often (ms).
+const uint32_t LOG_HEARTBEAT_INTERVAL = 60 * 60 * 1000ul;   // Store a record at least this often, changes or not (ms).
+const uint32_t CAPTURE_INTERVAL = 1000;                     // Check for changes this often in a capture window (ms).
+const uint32_t CAPTURE_DURATION = 30 * 60 * 1000ul;         // A capture window lasts this long after the trigger (ms).
+const uint32_t CAPTURE_TRIGGERS = bit(STATUS_FILLING_RESERVOIR) | bit(STATUS_DRAINING_RESERVOIR) |
+                                  bit(STATUS_DOSING_FERTILISER) | bit(STATUS_DOSING_PHMINUS);
+
+// Transmission cursor journal.
+const uint32_t LOG_SEQUENCE_BLOCK = 1024;                   // Sequence numbers reserved per EEPROM write.
+const uint16_t MAX_CURSOR_JOURNAL_SIZE = 1200;              // Compact the journal when it grows over this size (100 entries).
+const uint16_t MESSAGE_BUFFER_SIZE = 1024;                  // Size of the buffer of messages waiting to be stored.
+const uint16_t MESSAGE_BUFFER_HIGH_WATER = 768;             // Store the buffered messages when it's this full.
+const uint32_t MESSAGE_FLUSH_INTERVAL = 2000;               // Store the buffered messages after this long (ms).
+const uint16_t MAX_MESSAGE_INDEX_SIZE = 8192;               // Compact the message index when it grows over this size (2048 messages).
+const uint32_t CURSOR_CHECK = 0x5AC35AC3;                   // Check word of a journal entry is dataRecord ^ messageOffset ^ CURSOR_CHECK.
+const uint32_t LEGACY_CURSOR_CHECK = 0xA5C3A5C3;            // Same, for entries pointing into the old single-file logs.
 
-// Maximum file size to store messages and data.
-const uint16_t MAX_LOGFILE_SIZE = 20000;
-const uint16_t MAX_FILE_SIZE    = 20000;
+// Message record formats.
+const uint8_t MESSAGE_TEXT = 0xFF;                          // Plain text; also all records written before the catalogue.
+const uint8_t MESSAGE_CODED = 1;                            // Code from the message catalogue plus its arguments.
+
+// The message catalogue codes. These are stored in the log: never change the value of an existing code.
+const uint8_t MESSAGE_WATERTEMPSENSOR_01 = 0;
+const uint8_t MESSAGE_WATERTEMPSENSOR_10 = 1;
+const uint8_t MESSAGE_WATERLEVELSENSOR_01 = 2;
+const uint8_t MESSAGE_PHSENSOR_01 = 3;
+const uint8_t MESSAGE_PHSENSOR_02 = 4;
+const uint8_t MESSAGE_PHMINUS_01 = 5;
+const uint8_t MESSAGE_LOGGING_01 = 6;
+const uint8_t MESSAGE_LOGGING_02 = 7;
+const uint8_t MESSAGE_FERTILISER_01 = 8;
+const uint8_t MESSAGE_ECSENSOR_01 = 9;
+const uint8_t MESSAGE_ECSENSOR_02 = 10;
+const uint8_t MESSAGE_ECSENSOR_03 = 11;
+const uint8_t MESSAGE_DRAINAGE_01 = 12;
+const uint8_t MESSAGE_DRAINAGE_02 = 13;
+const uint8_t MESSAGE_DRAINAGE_03 = 14;
+const uint8_t MESSAGE_RESERVOIR_10 = 15;
+const uint8_t MESSAGE_RESERVOIR_11 = 16;
+const uint8_t MESSAGE_RESERVOIR_12 = 17;
+
+// Data record schemas.
+const uint8_t DATA_SCHEMA_RAW = 0;                          // A copy of HydroMonitorCore::SensorData.
+const uint8_t DATA_SCHEMA_PACKED = 1;                       // The channels of dataSchema, packed fixed point.
+const uint8_t DATA_SCHEMA_ROLLUP = 2;                       // Minimum, maximum and mean of each channel, packed, and the number of samples.
+
+// Rollups.
+const uint8_t ROLLUP_HOURLY = 0;
+const uint8_t ROLLUP_DAILY = 1;
+const uint8_t ROLLUPS = 2;
+const uint8_t MAX_ROLLUP_FIELDS = 24;                       // At least the number of channels in dataSchema.
+
+// Types of the SensorData members in the data schema.
+const uint8_t FIELD_FLOAT   = 0;
+const uint8_t FIELD_INT32   = 1;
+const uint8_t FIELD_UINT16  = 2;
+const uint8_t FIELD_BOOL    = 3;
+const uint8_t FIELD_UINT32  = 4;
 
 const uint8_t RECORD_STORED       = 0x01;
 const uint8_t RECORD_TRANSMITTED  =  0x02;
+const uint8_t RECORD_CHECKED      = 0x04;                   // Stored, with a CRC32 of the record in bytes 8-11.
 
 const uint8_t INVALID   = 0;
 const uint8_t UNCHECKED = 1;
@@ -66,6 +180,13 @@ class HydroMonitorLogging
     bool settingsJSON(ESP8266WebServer*);
 
     void messagesJSON(ESP8266WebServer*);
+    void dataQuery(ESP8266WebServer*);
+    void exportLog(ESP8266WebServer*);
+    void uploadStatsJSON(ESP8266WebServer*);
+    void historyJSON(ESP8266WebServer*);
+#ifdef STORAGE_TEST_BENCHMARK
+    void storageBenchmarkJSON(ESP8266WebServer*);
+#endif
 
     void logData();
     void getLogData(uint8_t);
@@ -73,63 +194,331 @@ class HydroMonitorLogging
     void resetLog();
     void transmitData();
     void transmitMessages();
+    void transmitBatch();
+    void transmitUrgent(HydroMonitorUploadScheduler::UploadQueues);
+    bool findUrgent(HydroMonitorUploadScheduler::UploadQueues);
+    HydroMonitorUploadScheduler::UploadQueues messageQueue(uint8_t);
+    bool messageSent(uint32_t, uint8_t);
 
     void checkCredentials(void);
     uint8_t hostValid;
     uint8_t pathValid;
     uint8_t loginValid;
 
-    void writeTrace(const char*);
-    void writeTrace(const __FlashStringHelper*);
-    void writeInfo(const char*);
-    void writeInfo(const __FlashStringHelper*);
-    void writeWarning(const char*);
-    void writeWarning(const __FlashStringHelper*);
-    void writeError(const char*);
-    void writeError(const __FlashStringHelper*);
+    // Whether a message of a module at level is logged. For callers that format the message first: inline, so
+    // levels above LOGLEVEL compile to nothing, the formatting included.
+    bool isLogged(uint8_t module, uint8_t level) {
+      return LOGLEVEL >= level && logLevel[module] >= level;
+    }
+
+    // Log a message of a module (LOG_MODULE_*). These are inline: levels above LOGLEVEL compile to nothing, and
+    // the runtime level of the module is checked before the message is copied.
+    void writeTrace(uint8_t module, const char* str) {
+      if (LOGLEVEL >= LOG_TRACE && logLevel[module] >= LOG_TRACE) {
+        writeText(LOG_TRACE, str);
+      }
+    }
+    void writeTrace(uint8_t module, const __FlashStringHelper* str) {
+      if (LOGLEVEL >= LOG_TRACE && logLevel[module] >= LOG_TRACE) {
+        writeText_P(LOG_TRACE, (PGM_P)str);
+      }
+    }
+    void writeInfo(uint8_t module, const char* str) {
+      if (LOGLEVEL >= LOG_INFO && logLevel[module] >= LOG_INFO) {
+        writeText(LOG_INFO, str);
+      }
+    }
+    void writeInfo(uint8_t module, const __FlashStringHelper* str) {
+      if (LOGLEVEL >= LOG_INFO && logLevel[module] >= LOG_INFO) {
+        writeText_P(LOG_INFO, (PGM_P)str);
+      }
+    }
+    void writeWarning(uint8_t module, const char* str) {
+      if (LOGLEVEL >= LOG_WARNING && logLevel[module] >= LOG_WARNING) {
+        writeText(LOG_WARNING, str);
+      }
+    }
+    void writeWarning(uint8_t module, const __FlashStringHelper* str) {
+      if (LOGLEVEL >= LOG_WARNING && logLevel[module] >= LOG_WARNING) {
+        writeText_P(LOG_WARNING, (PGM_P)str);
+      }
+    }
+    void writeError(uint8_t module, const char* str) {
+      if (LOGLEVEL >= LOG_ERROR && logLevel[module] >= LOG_ERROR) {
+        writeText(LOG_ERROR, str);
+      }
+    }
+    void writeError(uint8_t module, const __FlashStringHelper* str) {
+      if (LOGLEVEL >= LOG_ERROR && logLevel[module] >= LOG_ERROR) {
+        writeText_P(LOG_ERROR, (PGM_P)str);
+      }
+    }
+
+    // Messages without a module are logged as LOG_MODULE_MAIN.
+    void writeTrace(const char* str) { writeTrace(LOG_MODULE_MAIN, str); }
+    void writeTrace(const __FlashStringHelper* str) { writeTrace(LOG_MODULE_MAIN, str); }
+    void writeInfo(const char* str) { writeInfo(LOG_MODULE_MAIN, str); }
+    void writeInfo(const __FlashStringHelper* str) { writeInfo(LOG_MODULE_MAIN, str); }
+    void writeWarning(const char* str) { writeWarning(LOG_MODULE_MAIN, str); }
+    void writeWarning(const __FlashStringHelper* str) { writeWarning(LOG_MODULE_MAIN, str); }
+    void writeError(const char* str) { writeError(LOG_MODULE_MAIN, str); }
+    void writeError(const __FlashStringHelper* str) { writeError(LOG_MODULE_MAIN, str); }
+
+    // Coded messages: the module is taken from the message catalogue.
+    void writeWarning(uint8_t, float = NAN, float = NAN);
+    void writeError(uint8_t, float = NAN, float = NAN);
+
+    void setLogLevel(uint8_t, uint8_t);
 
   private:
-    void checkCredentials (char*, char*, char*, char*);
-    void getLogMessage(uint8_t*, uint32_t*);
+    bool getLogMessage(uint32_t, uint8_t*, uint32_t*);
 
     void writeLog(uint8_t);
+    void writeText(uint8_t, const char*);
+    void writeText_P(uint8_t, PGM_P);
+    uint8_t logLevel[LOG_MODULES];                          // Runtime log level of each module.
+    static const char* const logModuleNames[];
+    static const uint8_t messageModule[];
+    void writeCoded(uint8_t, uint8_t, float, float);
+    void formatMessage(const uint8_t*, uint8_t);
+    uint16_t readMessageRecord(HydroMonitorLogFile*, bool = true);
+    static const char* const messageCatalogue[];
     void bufferMsg_P(const char*);
     void bufferMsg(const char*);
-    char control[16];                                       // Buffer to store the control data: 16 bytes.
-    char buff[MAX_MESSAGE_SIZE + 1];                        // Buffer to store the data or message to log: MAX_MESSAGE_SIZE + null terminator.
-
-    uint16_t sendPostData(char*);
-    void initDataLogFile();
-    void initMessageLogFile();
-    void addMessageToList(uint32_t);
-    uint32_t latestMessageList[50];
-    uint32_t lastSent;
+    char record[16 + MAX_MESSAGE_SIZE + 1];                 // A complete message record: header followed by the message, so it's written in one go.
+    char* control = record;                                 // Buffer to store the control data: 16 bytes.
+    char* buff = record + 16;                               // Buffer to store the data or message to log: MAX_MESSAGE_SIZE + null terminator.
+
+    void dataTransmitted(uint32_t);
+    void messagesTransmitted(uint32_t);
+    bool dataFields(HydroMonitorQueryBuilder*, uint32_t, uint32_t, HydroMonitorCore::SensorData*);
+    bool messageFields(HydroMonitorQueryBuilder*, bool);
+    void initDataLog();
+    void initMessageLog();
+    void migrateLogFiles(bool);
+    bool readCursor();
+    void writeCursor(bool = false);
+
+    struct MessageHeader {
+      uint8_t status;                                       // Byte 0: record status.
+      uint8_t level;                                        // Byte 1: log level.
+      uint32_t timestamp;                                   // Bytes 2-5: seconds since epoch.
+      uint8_t format;                                       // Byte 6: MESSAGE_TEXT or MESSAGE_CODED.
+      uint8_t size;                                         // Byte 7: size of a coded message body.
+      uint32_t crc;                                         // Bytes 8-11: CRC32 of the record.
+      uint32_t sequence;                                    // Bytes 12-15: sequence number.
+    } __attribute__((packed));
+
+    struct DataHeader {
+      uint8_t status;                                       // Byte 0: record status.
+      uint32_t timestamp;                                   // Bytes 1-4: seconds since epoch.
+      uint8_t unused;                                       // Byte 5.
+      uint8_t schema;                                       // Byte 6: DATA_SCHEMA_*.
+      uint8_t size;                                         // Byte 7: size of the sensor data.
+      uint32_t crc;                                         // Bytes 8-11: CRC32 of the record.
+      uint32_t sequence;                                    // Bytes 12-15: sequence number.
+    } __attribute__((packed));
+
+    struct DataField {
+      uint16_t member;                                      // Offset of the member in SensorData.
+      uint8_t type;                                         // FIELD_* type of the member.
+      uint8_t width;                                        // Bytes in the record: 1, 2 or 4.
+      float scale;                                          // Value of one step.
+      float zero;                                           // Value stored as 0.
+      float deadband;                                       // Smallest change worth a new record; 0: any change.
+      const char* name;                                     // Name of the channel in data queries.
+    };
+    static const DataField dataSchema[];
+    static uint8_t schemaSize();
+    void packData(uint8_t*, HydroMonitorCore::SensorData*);
+    void unpackData(const uint8_t*, HydroMonitorCore::SensorData*);
+    uint32_t packField(const DataField*, const HydroMonitorCore::SensorData*);
+    void unpackField(const DataField*, HydroMonitorCore::SensorData*, uint32_t);
+    uint16_t readDataRecord(HydroMonitorLogFile*, uint32_t*, HydroMonitorCore::SensorData*, uint32_t* = NULL);
+    static uint32_t crc32(const uint8_t*, uint16_t, uint32_t = 0);
+    static bool validStatus(uint8_t);
+    static uint32_t recordCrc(const uint8_t*, const uint8_t*, uint16_t);
+    static void sealRecord(uint8_t*, uint16_t);
+    static bool checkRecord(const uint8_t*, const uint8_t*, uint16_t);
+    enum StoreTypes {
+      STORE_DATA,
+      STORE_ROLLUP,
+      STORE_MESSAGE,
+    };
+    void repairTail(HydroMonitorLogStore*, StoreTypes);
+    uint32_t findRecord(HydroMonitorLogStore*, uint16_t, uint32_t);
+    uint32_t recordTimestamp(HydroMonitorLogStore*, uint32_t);
+    float getField(const DataField*, const HydroMonitorCore::SensorData*);
+    void setField(const DataField*, HydroMonitorCore::SensorData*, float);
+
+    struct Rollup {
+      uint32_t start;                                       // Start of the period (seconds since epoch).
+      uint16_t count;                                       // Number of samples in the period.
+      HydroMonitorCore::SensorData minimum;
+      HydroMonitorCore::SensorData maximum;
+      HydroMonitorCore::SensorData latest;
+      float sum[MAX_ROLLUP_FIELDS];                         // Sum of each channel, indexed as dataSchema.
+    };
+    static const uint32_t rollupPeriod[];
+    Rollup rollup[ROLLUPS];
+    HydroMonitorFileLogStorage rollupStorage[ROLLUPS];
+    HydroMonitorLogStore rollupStore[ROLLUPS];
+    void addToRollups(uint32_t, HydroMonitorCore::SensorData*);
+    void addToHistory(uint32_t, HydroMonitorCore::SensorData*);
+    HydroMonitorHistory history;                            // The last 24 hours, for the dashboard.
+    void writeRollup(uint8_t);
+    uint16_t readRollupRecord(HydroMonitorLogFile*, uint32_t*, HydroMonitorCore::SensorData*, uint16_t*);
+    uint8_t fieldValue(char*, const DataField*, HydroMonitorCore::SensorData*);
+    void exportRaw(ESP8266WebServer*, HydroMonitorLogStore*, const char*);
+    void exportMessages(ESP8266WebServer*);
+#ifdef STORAGE_TEST_BENCHMARK
+    void benchmarkJSON(ESP8266WebServer*, const char*, HydroMonitorLogStorage*, const char*, bool);
+#endif
+
+    struct Cursor {
+      uint32_t dataRecord;                                  // Position of the next data record to transmit.
+      uint32_t messageOffset;                               // Position of the next message to transmit.
+      uint32_t check;
+    };
+    void addMessage(File*, uint32_t, MessageHeader*, const uint8_t*, uint16_t);
+    void bufferMessage(const uint8_t*, uint16_t);
+    void flushMessages();
+    uint16_t messageRecordSize(const uint8_t*);
+    uint8_t messageBuffer[MESSAGE_BUFFER_SIZE];             // Message records waiting to be stored.
+    uint16_t messageBufferSize = 0;                         // Bytes in messageBuffer.
+    uint32_t lastMessageFlush = 0;
+    bool messageStoreReady = false;                         // The message store has been started: we can flush.
+    uint32_t messagesDropped = 0;                           // Messages lost as the buffer was full before the store was started.
+    void compactMessageIndex();
+    HydroMonitorMessageCache messageCache;                  // The latest messages, for the web interface.
+    uint32_t indexCount = 0;                                // Number of entries in the message index.
+    bool indexReady = false;                                // The message index is up to date with the message log.
     uint32_t lastWarned = -WARNING_INTERVAL;
 
     Settings settings;
     Settings localSettings;
     HydroMonitorCore::SensorData *sensorData;
     HydroMonitorCore core;
+    HydroMonitorConnection connection;                      // Keep-alive connection to the logging server.
+    HydroMonitorFileLogStorage dataStorage;
+    HydroMonitorFileLogStorage messageStorage;
+#ifdef USE_24LC256_EEPROM
+    HydroMonitorEepromPages eepromPages;
+    HydroMonitorEepromLogStorage dataHotStorage;
+    HydroMonitorEepromLogStorage messageHotStorage;
+    HydroMonitorTieredLogStorage dataTier;                  // Newest data records in EEPROM, the rest in dataStorage.
+    HydroMonitorTieredLogStorage messageTier;
+    struct EepromCursor {
+      uint32_t dataRecord;
+      uint32_t messageOffset;
+      uint32_t serial;                                      // The highest serial is the latest entry.
+      uint32_t check;
+    };
+    uint8_t cursorSlot = EEPROM_CURSOR_ENTRIES - 1;         // Entry of the ring holding the latest cursor.
+    uint32_t cursorSerial = 0;
+    bool readEepromCursor();
+    bool writeEepromCursor();
+#endif
+    HydroMonitorLogStore dataStore;
+    HydroMonitorLogStore messageStore;
+    bool legacyCursor = false;                              // The journal entry points into the old log files.
+    uint32_t sequence;                                      // Sequence number of the next record.
+    uint32_t sequenceLimit;                                 // End of the block of sequence numbers reserved in EEPROM.
+    uint32_t nextSequence();
+    bool validSequence(uint32_t);
 
     const uint16_t httpsPort = 443;
     char* username;
     char* password;
 
-    uint32_t lastLogSensorData = -REFRESH_DATABASE;
+    uint32_t lastLogSensorData = -REFRESH_DATABASE;         // Latest sample for the rollups.
+    uint32_t lastSample = -LOG_SAMPLE_INTERVAL;             // Latest sample for the data log.
+    uint32_t lastStored = -LOG_HEARTBEAT_INTERVAL;          // Latest record stored.
+    uint32_t captureStart;                                  // Start of the capture window, or the latest trigger.
+    bool capturing = false;                                 // In a capture window: sample every CAPTURE_INTERVAL.
+    uint32_t lastTriggers = 0;                              // The CAPTURE_TRIGGERS bits set at the latest sample.
+    HydroMonitorCore::SensorData storedData;                // Sensor data of the latest record stored.
+    uint32_t recordsSuppressed = 0;                         // Samples not stored as nothing changed.
+    bool dataChanged();
+    void storeData();
     bool dataTransmitComplete;
     uint32_t dataRecordToTransmit;
     bool messageTransmitComplete;
     uint32_t messageToTransmit;
-    bool connectionFailed = false;
-    uint32_t connectionFailTime = -CONNECTION_RETRY_DELAY;
+    HydroMonitorUploadScheduler scheduler;                  // When to upload: retries and rate limiting.
+    bool batchSupported = true;                             // Set to false if the server rejects batch uploads.
+    uint8_t batchSize = 10;                                 // Records per batch, adapted to the measured response time.
+    uint32_t responseTime;                                  // Duration of the latest request (ms).
+    char requestBuff[REQUEST_BUFFER_SIZE];                  // The upload in progress: the path, followed by the POST body of a batch.
+
+    enum UploadTypes {
+      UPLOAD_NONE,                                          // No upload in progress.
+      UPLOAD_DATA,                                          // A single data record.
+      UPLOAD_MESSAGE,                                       // A single message.
+      UPLOAD_BATCH,                                         // A batch of records.
+      UPLOAD_URGENT,                                        // A single error or warning, ahead of the queue.
+      UPLOAD_VALIDATE,                                      // The credentials check.
+    };
+    UploadTypes upload = UPLOAD_NONE;
+    uint32_t uploadDataEnd;                                 // Data cursor after a successful upload.
+    uint32_t uploadMessageEnd;                              // Message cursor after a successful upload.
+    uint8_t uploadRecords;                                  // Records in the batch.
+    HydroMonitorUploadScheduler::UploadQueues uploadQueue;  // Queue of the urgent message.
+    uint32_t uploadUrgentEnd;                               // End of the urgent message.
+    uint32_t urgentNext[2];                                 // Errors, warnings: those before this position have been sent.
+    uint16_t uploadBytes;                                   // Size of the request: path and body.
+    uint32_t uploadStarted;                                 // When the upload started (ms).
+    void requestPath(HydroMonitorQueryBuilder*, const char*, const char*, const char*);
+    void startUpload(UploadTypes, char* = NULL);
+    void uploadFinished(int16_t);
+    void credentialsChecked(int16_t);
+    bool saveSettings = false;                              // Store the settings once the new credentials are found valid.
+    void reportTiming(int16_t);
+
+#ifdef LOG_MQTT
+    struct Publication {
+      uint32_t dataEnd;                                     // Data cursor once this publication is acknowledged.
+      uint32_t messageEnd;                                  // Message cursor once this publication is acknowledged.
+      uint16_t bytes;                                       // Size of the topic and payload.
+    };
+    HydroMonitorMqtt mqtt;                                  // Connection to the MQTT broker.
+    Publication publication[MQTT_MAX_IN_FLIGHT];            // The publications in flight, oldest first, like in mqtt.
+    uint8_t firstPublication = 0;
+    uint8_t nPublications = 0;
+    uint32_t recordsRepublished = 0;                        // Records in flight when the connection was lost, so published again.
+    uint32_t publishDataNext;                               // Position of the next data record to publish.
+    uint32_t publishMessageNext;                            // Position of the next message to publish.
+    char topic[MAX_MQTT_TOPIC_SIZE];
+    void connectMqtt();
+    void publishRecords();
+    bool publishData();
+    bool publishMessage();
+    bool publish(uint16_t, uint32_t, uint32_t);
+#endif
+
+    const char* dataLogDirectory = "/dl/";
+    const char* messageLogDirectory = "/ml/";
+    const char* hourlyRollupDirectory = "/rh/";
+    const char* dailyRollupDirectory = "/rd/";
+#ifdef STORAGE_TEST_BENCHMARK
+    const char* benchmarkDirectory = "/bm/";
+#endif
 
-    const char* dataLogFileName = "datalog";
+    const char* dataLogFileName = "datalog";                // The old log files.
     const char* dataLogFile1Name = "datalog1";
 
     const char* messageLogFileName = "messagelog";
     const char* messageLogFile1Name = "messagelog1";
 
-    const uint8_t dataRecordSize = sizeof(HydroMonitorCore::SensorData);
+    const char* messageIndexFileName = "/mi";
+    const char* messageIndexFile1Name = "/mi1";
+
+    const char* cursorLogFileName = "cursorlog";
+    const char* cursorLogFile1Name = "cursorlog1";
+
+    const uint8_t dataRecordSize = schemaSize();            // Size of the packed sensor data.
     const uint8_t fileRecordSize = dataRecordSize + 16;
+    const uint8_t rollupRecordSize = 3 * dataRecordSize + 2; // Size of the body of a rollup record.
+    const uint16_t legacyRecordSize = sizeof(HydroMonitorCore::SensorData) + 16; // Record size of the old data log file.
 };
 #endif
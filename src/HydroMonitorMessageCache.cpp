@@ -0,0 +1,85 @@
+#include <HydroMonitorMessageCache.h>
+
+/*
+   RAM ring buffer of the most recent log messages.
+*/
+
+/*
+   The constructor.
+*/
+HydroMonitorMessageCache::HydroMonitorMessageCache() {
+  clear();
+}
+
+/*
+   Remove all messages.
+*/
+void HydroMonitorMessageCache::clear() {
+  first = 0;
+  nEntries = 0;
+  head = 0;
+  used = 0;
+}
+
+/*
+   Number of messages held.
+*/
+uint8_t HydroMonitorMessageCache::count() {
+  return nEntries;
+}
+
+/*
+   Add a message: entry holds the level, format, time stamp and size of the body.
+*/
+void HydroMonitorMessageCache::add(Entry* entry, const uint8_t* body) {
+  uint16_t size = sizeof(Entry) + entry->size;
+  if (size > MESSAGE_CACHE_SIZE) {
+    return;
+  }
+  while (nEntries > 0 &&
+         (nEntries == MESSAGE_CACHE_ENTRIES || used + size > MESSAGE_CACHE_SIZE)) { // Drop the oldest message.
+    Entry oldest;
+    read(entryOffset[first], &oldest, sizeof(Entry));
+    used -= sizeof(Entry) + oldest.size;
+    first = (first + 1) % MESSAGE_CACHE_ENTRIES;
+    nEntries--;
+  }
+  entryOffset[(first + nEntries) % MESSAGE_CACHE_ENTRIES] = head;
+  nEntries++;
+  write(head, entry, sizeof(Entry));
+  write((head + sizeof(Entry)) % MESSAGE_CACHE_SIZE, body, entry->size);
+  head = (head + size) % MESSAGE_CACHE_SIZE;
+  used += size;
+}
+
+/*
+   Get message i (0 = the latest): its entry header, and the body in body.
+   Returns the size of the body, or 0 if we don't have that message.
+*/
+uint16_t HydroMonitorMessageCache::get(uint8_t i, Entry* entry, uint8_t* body) {
+  if (i >= nEntries) {
+    return 0;
+  }
+  uint16_t offset = entryOffset[(first + nEntries - 1 - i) % MESSAGE_CACHE_ENTRIES];
+  read(offset, entry, sizeof(Entry));
+  read((offset + sizeof(Entry)) % MESSAGE_CACHE_SIZE, body, entry->size);
+  return entry->size;
+}
+
+/*
+   Copy n bytes to the buffer, starting at offset, wrapping around the end.
+*/
+void HydroMonitorMessageCache::write(uint16_t offset, const void* data, uint16_t n) {
+  uint16_t part = min(n, (uint16_t)(MESSAGE_CACHE_SIZE - offset));
+  memcpy(buffer + offset, data, part);
+  memcpy(buffer, (const uint8_t*)data + part, n - part);
+}
+
+/*
+   Copy n bytes from the buffer, starting at offset, wrapping around the end.
+*/
+void HydroMonitorMessageCache::read(uint16_t offset, void* data, uint16_t n) {
+  uint16_t part = min(n, (uint16_t)(MESSAGE_CACHE_SIZE - offset));
+  memcpy(data, buffer + offset, part);
+  memcpy((uint8_t*)data + part, buffer, n - part);
+}
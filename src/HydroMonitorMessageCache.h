@@ -0,0 +1,49 @@
+/*
+   HydroMonitorMessageCache
+
+   The most recent log messages, kept in RAM for the web interface.
+
+   Messages are stored as they are in the message log - a plain text, or a catalogue code with its arguments -
+   in a ring buffer of MESSAGE_CACHE_SIZE bytes. Each entry is an 8-byte Entry header followed by the message
+   body; entries wrap around the end of the buffer. Adding a message drops the oldest ones as needed to make
+   space, so the number of messages held depends on their size (at most MESSAGE_CACHE_ENTRIES).
+
+*/
+
+#ifndef HYDROMONITORMESSAGECACHE_H
+#define HYDROMONITORMESSAGECACHE_H
+
+#include <Arduino.h>
+
+const uint16_t MESSAGE_CACHE_SIZE = 2048;                   // Size of the ring buffer.
+const uint8_t MESSAGE_CACHE_ENTRIES = 50;                   // Maximum number of messages held.
+
+class HydroMonitorMessageCache
+{
+  public:
+
+    struct Entry {
+      uint16_t size;                                        // Size of the body.
+      uint8_t level;                                        // Log level.
+      uint8_t format;                                       // MESSAGE_TEXT or MESSAGE_CODED.
+      uint32_t timestamp;
+    } __attribute__((packed));
+
+    HydroMonitorMessageCache();
+    void add(Entry*, const uint8_t*);
+    uint16_t get(uint8_t, Entry*, uint8_t*);
+    void clear();
+    uint8_t count();
+
+  private:
+    void write(uint16_t, const void*, uint16_t);
+    void read(uint16_t, void*, uint16_t);
+
+    uint8_t buffer[MESSAGE_CACHE_SIZE];
+    uint16_t entryOffset[MESSAGE_CACHE_ENTRIES];            // Ring of entry positions in buffer, oldest first.
+    uint8_t first;                                          // Index in entryOffset of the oldest entry.
+    uint8_t nEntries;
+    uint16_t head;                                          // Where the next entry goes in buffer.
+    uint16_t used;                                          // Bytes in use.
+};
+#endif
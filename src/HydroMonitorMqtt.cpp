@@ -0,0 +1,296 @@
+#include <HydroMonitorMqtt.h>
+
+/*
+   Minimal MQTT 3.1.1 client: QoS 1 publishing only.
+*/
+
+/*
+   The constructor.
+*/
+HydroMonitorMqtt::HydroMonitorMqtt() {
+  first = 0;
+  nInFlight = 0;
+}
+
+/*
+   Set the broker to connect to. The host name must remain valid while connected.
+*/
+void HydroMonitorMqtt::setServer(const char* h, uint16_t p) {
+  host = h;
+  port = p;
+}
+
+/*
+   Set the client id and the login. These must remain valid while connected.
+*/
+void HydroMonitorMqtt::setLogin(const char* id, const char* user, const char* pass) {
+  clientId = id;
+  username = user;
+  password = pass;
+}
+
+/********************************************************************************************************************
+   Open the connection to the broker and send the CONNECT packet. poll() handles the CONNACK; ready() tells when
+   we may publish.
+   Returns CONNECTION_BUSY (0) if the CONNECT was sent, or a negative CONNECTION_* code on failure.
+*/
+int16_t HydroMonitorMqtt::connect() {
+  stop();
+  IPAddress ip;
+  if (WiFi.hostByName(host, ip, DNS_TIMEOUT) != 1) {
+    return CONNECTION_DNS_FAILED;
+  }
+  client.setTimeout(TCP_CONNECT_TIMEOUT);
+  if (client.connect(ip, port) == false) {
+    return CONNECTION_CONNECT_FAILED;
+  }
+  client.setNoDelay(true);                                  // Small packets: don't wait for more to send.
+
+  // The variable header and payload: protocol name and level, flags, keep-alive, client id, user name, password.
+  uint8_t buffer[10 + 3 * 2 + 32 + 33 + 33 + 5];
+  uint16_t length = 5;                                      // Room for the fixed header.
+  static const uint8_t variableHeader[] PROGMEM = {0x00, 0x04, 'M', 'Q', 'T', 'T', 0x04, 0xC2}; // User name, password, clean session.
+  memcpy_P(buffer + length, variableHeader, sizeof(variableHeader));
+  length += sizeof(variableHeader);
+  buffer[length++] = MQTT_KEEP_ALIVE >> 8;
+  buffer[length++] = MQTT_KEEP_ALIVE & 0xFF;
+  writeString(buffer, &length, clientId);
+  writeString(buffer, &length, username);
+  writeString(buffer, &length, password);
+
+  // The fixed header goes in front of it, right aligned.
+  uint8_t header[5];
+  header[0] = 0x10;                                         // CONNECT.
+  uint8_t headerSize = 1 + writeLength(header + 1, length - 5);
+  memcpy(buffer + 5 - headerSize, header, headerSize);
+  if (client.write(buffer + 5 - headerSize, length - 5 + headerSize) == 0) {
+    client.stop();
+    return CONNECTION_SEND_FAILED;
+  }
+  lastSent = millis();
+  waitStart = millis();
+  state = STATE_CONNACK;
+  return CONNECTION_BUSY;
+}
+
+/********************************************************************************************************************
+   Whether we have a connection to the broker (possibly still waiting for the CONNACK).
+*/
+bool HydroMonitorMqtt::connected() {
+  return state != STATE_DISCONNECTED && client.connected();
+}
+
+/********************************************************************************************************************
+   Whether we may publish: the broker accepted the connection and there's room for another publication in flight.
+*/
+bool HydroMonitorMqtt::ready() {
+  return state == STATE_CONNECTED && nInFlight < MQTT_MAX_IN_FLIGHT;
+}
+
+/********************************************************************************************************************
+   Publish payload on topic with QoS 1.
+   Returns false if the publication could not be sent.
+*/
+bool HydroMonitorMqtt::publish(const char* topic, const uint8_t* payload, uint16_t size) {
+  if (ready() == false) {
+    return false;
+  }
+  uint16_t topicLength = strlen(topic);
+  uint8_t header[5 + 2 + MAX_MQTT_TOPIC_SIZE + 2];
+  header[0] = 0x32;                                         // PUBLISH, QoS 1.
+  uint16_t length = 1 + writeLength(header + 1, 2 + topicLength + 2 + size);
+  writeString(header, &length, topic);
+  uint16_t id = nextPacketId;
+  header[length++] = id >> 8;
+  header[length++] = id & 0xFF;
+  if (client.write(header, length) != length || client.write(payload, size) != size) {
+    stop();
+    return false;
+  }
+  nextPacketId = (nextPacketId == 0xFFFF) ? 1 : nextPacketId + 1; // Packet id 0 is not allowed.
+  uint8_t i = (first + nInFlight) % MQTT_MAX_IN_FLIGHT;
+  packetId[i] = id;
+  acked[i] = false;
+  if (nInFlight == 0) {
+    waitStart = millis();
+  }
+  nInFlight++;
+  lastSent = millis();
+  return true;
+}
+
+/********************************************************************************************************************
+   Handle what came in from the broker, and keep the connection alive.
+   Returns CONNECTION_BUSY (0) while all is well, or a negative code if the connection was lost or refused.
+*/
+int16_t HydroMonitorMqtt::poll() {
+  if (state == STATE_DISCONNECTED) {
+    return CONNECTION_BUSY;
+  }
+  while (readPacket()) {
+    handlePacket();
+    if (state == STATE_DISCONNECTED) {                      // Connection refused.
+      return MQTT_CONNECTION_REFUSED;
+    }
+  }
+  if (client.connected() == false) {
+    stop();
+    return CONNECTION_CONNECT_FAILED;
+  }
+  if ((state == STATE_CONNACK || nInFlight > 0) && millis() - waitStart > MQTT_ACK_TIMEOUT) {
+    stop();                                                 // The broker doesn't respond: start over.
+    return CONNECTION_TIMEOUT;
+  }
+  if (millis() - lastSent > MQTT_KEEP_ALIVE * 1000ul / 2) {  // Nothing sent for a while: ping.
+    static const uint8_t pingRequest[] = {0xC0, 0x00};
+    client.write(pingRequest, sizeof(pingRequest));
+    lastSent = millis();
+  }
+  return CONNECTION_BUSY;
+}
+
+/********************************************************************************************************************
+   The number of the oldest publications in flight that have been acknowledged since the last call. These are
+   removed from the list.
+*/
+uint8_t HydroMonitorMqtt::acknowledged() {
+  uint8_t n = 0;
+  while (nInFlight > 0 && acked[first]) {
+    first = (first + 1) % MQTT_MAX_IN_FLIGHT;
+    nInFlight--;
+    n++;
+  }
+  if (n > 0) {
+    waitStart = millis();                                   // Now waiting for the next one.
+  }
+  return n;
+}
+
+/********************************************************************************************************************
+   Number of publications waiting for their PUBACK.
+*/
+uint8_t HydroMonitorMqtt::inFlight() {
+  return nInFlight;
+}
+
+/********************************************************************************************************************
+   Close the connection. Publications in flight are forgotten.
+*/
+void HydroMonitorMqtt::stop() {
+  if (state == STATE_CONNECTED && client.connected()) {
+    static const uint8_t disconnect[] = {0xE0, 0x00};
+    client.write(disconnect, sizeof(disconnect));
+  }
+  client.stop();
+  state = STATE_DISCONNECTED;
+  nInFlight = 0;
+  headerBytes = 0;
+  haveHeader = false;
+}
+
+/********************************************************************************************************************
+   Append a string to buffer at length: 2 bytes length, followed by the characters.
+*/
+void HydroMonitorMqtt::writeString(uint8_t* buffer, uint16_t* length, const char* str) {
+  uint16_t size = strlen(str);
+  buffer[(*length)++] = size >> 8;
+  buffer[(*length)++] = size & 0xFF;
+  memcpy(buffer + *length, str, size);
+  *length += size;
+}
+
+/********************************************************************************************************************
+   Write the remaining length field of a fixed header: 7 bits per byte, least significant first.
+   Returns the number of bytes written.
+*/
+uint8_t HydroMonitorMqtt::writeLength(uint8_t* buffer, uint32_t length) {
+  uint8_t n = 0;
+  do {
+    buffer[n] = length & 0x7F;
+    length >>= 7;
+    if (length > 0) {
+      buffer[n] |= 0x80;
+    }
+    n++;
+  } while (length > 0);
+  return n;
+}
+
+/********************************************************************************************************************
+   Read what has come in of the next packet. Only the first bytes of the packet are kept in packet; that's all
+   we need of the packets we expect.
+   Returns true if a complete packet was read.
+*/
+bool HydroMonitorMqtt::readPacket() {
+  while (client.available() > 0) {
+    uint8_t c = client.read();
+    if (headerBytes == 0) {                                 // Packet type.
+      packetType = c >> 4;
+      remaining = 0;
+      received = 0;
+      headerBytes = 1;
+      continue;
+    }
+    if (haveHeader == false) {                              // Remaining length.
+      remaining |= (uint32_t)(c & 0x7F) << (7 * (headerBytes - 1));
+      headerBytes++;
+      if ((c & 0x80) == 0) {
+        haveHeader = true;
+      }
+      if (haveHeader == false || remaining > 0) {
+        continue;
+      }
+    }
+    else {
+      if (received < sizeof(packet)) {
+        packet[received] = c;
+      }
+      received++;
+      remaining--;
+      if (remaining > 0) {
+        continue;
+      }
+    }
+    headerBytes = 0;                                        // Packet complete.
+    haveHeader = false;
+    return true;
+  }
+  return false;
+}
+
+/********************************************************************************************************************
+   Handle a complete packet from the broker.
+*/
+void HydroMonitorMqtt::handlePacket() {
+  switch (packetType) {
+    case 2:                                                 // CONNACK: flags, return code.
+      connackCode = packet[1];
+      if (connackCode == 0) {
+        state = STATE_CONNECTED;
+      }
+      else {
+        stop();
+      }
+      break;
+
+    case 4: {                                               // PUBACK: packet id.
+      uint16_t id = (packet[0] << 8) | packet[1];
+#ifdef MQTT_TEST_DROP_PUBACKS
+      if (random(100) < MQTT_TEST_DROP_PUBACKS) {           // Test: lose the PUBACK, so the publication times out.
+        break;
+      }
+#endif
+      for (uint8_t i = 0; i < nInFlight; i++) {
+        uint8_t j = (first + i) % MQTT_MAX_IN_FLIGHT;
+        if (packetId[j] == id) {
+          acked[j] = true;
+          break;
+        }
+      }
+      break;
+    }
+
+    default:                                                // PINGRESP, and anything else we don't need.
+      break;
+  }
+}
@@ -0,0 +1,86 @@
+/*
+   HydroMonitorMqtt
+
+   A minimal MQTT 3.1.1 client, for publishing the log records to a broker with QoS 1.
+
+   Only what the uploader needs is implemented: connect with user name and password (clean session), publish with
+   QoS 1, and keep-alive pings. Up to MQTT_MAX_IN_FLIGHT publications may be waiting for their PUBACK at the same
+   time, so the records are not limited to one round trip each. The broker acknowledges QoS 1 publications in
+   the order they were sent; acknowledged() returns how many of the oldest publications have been acknowledged
+   since the last call, so the caller can move its cursor past them.
+
+   Like HydroMonitorConnection nothing blocks for long: connect() resolves the host and opens the TCP connection
+   with short timeouts, the CONNACK and PUBACKs are handled by poll(). If a PUBACK doesn't come in within
+   MQTT_ACK_TIMEOUT, or the connection is lost, the connection is closed and all publications in flight are
+   considered lost: the caller sends them again (QoS 1 is at least once delivery).
+
+   To test the redelivery a board may define MQTT_TEST_DROP_PUBACKS (0-100): that percentage of the PUBACKs is
+   ignored, as if it never came in. For testing only.
+
+*/
+
+#ifndef HYDROMONITORMQTT_H
+#define HYDROMONITORMQTT_H
+
+#include <ESP8266WiFi.h>
+#include <HydroMonitorConnection.h>
+
+const uint8_t MQTT_MAX_IN_FLIGHT = 8;                       // Publications waiting for their PUBACK.
+const uint16_t MQTT_KEEP_ALIVE = 60;                        // Keep-alive interval (s).
+const uint16_t MQTT_ACK_TIMEOUT = 10000;                    // Time to wait for a CONNACK or PUBACK (ms).
+const uint8_t MAX_MQTT_TOPIC_SIZE = 64;                     // Longest topic we publish on.
+
+const int16_t MQTT_CONNECTION_REFUSED = -10;                // Broker refused the connection; see connackCode.
+
+class HydroMonitorMqtt
+{
+  public:
+    HydroMonitorMqtt();
+    void setServer(const char*, uint16_t);
+    void setLogin(const char*, const char*, const char*);
+    int16_t connect();
+    bool connected();
+    bool ready();
+    bool publish(const char*, const uint8_t*, uint16_t);
+    int16_t poll();
+    uint8_t acknowledged();
+    uint8_t inFlight();
+    void stop();
+    uint8_t connackCode;                                    // Return code of the latest CONNACK; 4 and 5: login refused.
+
+  private:
+    enum MqttStates {
+      STATE_DISCONNECTED,
+      STATE_CONNACK,                                        // CONNECT sent, waiting for the CONNACK.
+      STATE_CONNECTED,
+    };
+
+    void writeString(uint8_t*, uint16_t*, const char*);
+    uint8_t writeLength(uint8_t*, uint32_t);
+    bool readPacket();
+    void handlePacket();
+
+    WiFiClient client;
+    MqttStates state = STATE_DISCONNECTED;
+    const char* host;
+    uint16_t port;
+    const char* clientId;
+    const char* username;
+    const char* password;
+    uint32_t lastSent;                                      // When we last sent something: for the keep-alive.
+    uint32_t waitStart;                                     // When we started waiting for the oldest acknowledgement.
+
+    uint16_t nextPacketId = 1;
+    uint16_t packetId[MQTT_MAX_IN_FLIGHT];                  // Ring of the publications in flight, oldest first.
+    bool acked[MQTT_MAX_IN_FLIGHT];
+    uint8_t first;                                          // Index of the oldest publication in flight.
+    uint8_t nInFlight;
+
+    uint8_t packet[4];                                      // The incoming packet: we only need the first bytes.
+    uint8_t packetType;
+    uint32_t remaining;                                     // Bytes of the incoming packet still to read.
+    uint32_t received;                                      // Bytes of the packet read, after the fixed header.
+    uint8_t headerBytes = 0;                                // Bytes of the fixed header read.
+    bool haveHeader = false;                                // The fixed header is complete.
+};
+#endif
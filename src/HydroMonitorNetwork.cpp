@@ -16,7 +16,7 @@ HydroMonitorNetwork::HydroMonitorNetwork() {
 void HydroMonitorNetwork::begin(HydroMonitorCore::SensorData *sd, HydroMonitorLogging *l, ESP8266WebServer *srv) {
   sensorData = sd;
   logging = l;
-  logging->writeTrace(F("HydroMonitorNetwork: configured networking services."));
+  logging->writeTrace(LOG_MODULE_NETWORK, F("HydroMonitorNetwork: configured networking services."));
   if (NETWORK_EEPROM > 0) {
 #ifdef USE_24LC256_EEPROM
     sensorData->EEPROM->get(NETWORK_EEPROM, settings);
@@ -75,13 +75,13 @@ bool HydroMonitorNetwork::ntpCheck() {
 
   // Timeout after 30 seconds.
   if (millis() - startTime > 30 * 1000ul) {
-    logging->writeTrace(F("HydroMonitorNetwork: NTP timeout."));
+    logging->writeTrace(LOG_MODULE_NETWORK, F("HydroMonitorNetwork: NTP timeout."));
     return false;
   }
 
   // Re-request every 5 seconds.
   if (millis() - updateTime > 5 * 1000ul) {
-    logging->writeTrace(F("HydroMonitorNetwork: Re-requesting the time from NTP server."));
+    logging->writeTrace(LOG_MODULE_NETWORK, F("HydroMonitorNetwork: Re-requesting the time from NTP server."));
     udp.stop();
     yield();
     udp.begin(LOCAL_NTP_PORT);
@@ -94,7 +94,7 @@ bool HydroMonitorNetwork::ntpCheck() {
   if (doNtpUpdateCheck()) {
     udp.stop();
     setTime(epoch);                                         // We use UTC internally, easier overall.
-    logging->writeTrace(F("HydroMonitorNetwork: successfully received time over NTP."));
+    logging->writeTrace(LOG_MODULE_NETWORK, F("HydroMonitorNetwork: successfully received time over NTP."));
     return false;
   }
 
@@ -129,7 +129,7 @@ uint32_t HydroMonitorNetwork::sendNTPpacket(IPAddress & address) {
   udp.write(packetBuffer, NTP_PACKET_SIZE);
   udp.endPacket();
   yield();
-  logging->writeTrace(F("HydroMonitorNetwork: NTP packet sent."));
+  logging->writeTrace(LOG_MODULE_NETWORK, F("HydroMonitorNetwork: NTP packet sent."));
 }
 
 /**
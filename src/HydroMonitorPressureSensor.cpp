@@ -12,12 +12,12 @@ HydroMonitorPressureSensor::HydroMonitorPressureSensor () {
 #ifdef USE_BMP180
 void HydroMonitorPressureSensor::begin(HydroMonitorCore::SensorData *sd, HydroMonitorLogging *l, BMP180 *bmp) {
   bmp180 = bmp;
-  l->writeTrace(F("HydroMonitorPressureSensor: configured a BMP180 sensor."));
+  l->writeTrace(LOG_MODULE_PRESSURESENSOR, F("HydroMonitorPressureSensor: configured a BMP180 sensor."));
 
 #elif defined(USE_BMP280) || defined(USE_BME280)
 void HydroMonitorPressureSensor::begin(HydroMonitorCore::SensorData * sd, HydroMonitorLogging * l, BME280 * bmp) {
   bmp280 = bmp;
-  l->writeTrace(F("HydroMonitorPressureSensor: configured a BME280 sensor."));
+  l->writeTrace(LOG_MODULE_PRESSURESENSOR, F("HydroMonitorPressureSensor: configured a BME280 sensor."));
 #endif
 
   sensorData = sd;
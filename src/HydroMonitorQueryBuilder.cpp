@@ -0,0 +1,217 @@
+#include <HydroMonitorQueryBuilder.h>
+
+/*
+   Append-only query string builder.
+*/
+
+/*
+   The constructor: build the string in buf, of s bytes.
+*/
+HydroMonitorQueryBuilder::HydroMonitorQueryBuilder(char* buf, uint16_t s) {
+  buffer = buf;
+  size = s;
+  buffer[0] = 0;
+}
+
+/*
+   Add str as it is.
+*/
+bool HydroMonitorQueryBuilder::add(const char* str) {
+  uint16_t n = strlen(str);
+  if (fits(n) == false) {
+    return false;
+  }
+  memcpy(buffer + end, str, n + 1);
+  end += n;
+  return true;
+}
+
+/*
+   Add the PROGMEM string str as it is.
+*/
+bool HydroMonitorQueryBuilder::add_P(PGM_P str) {
+  uint16_t n = strlen_P(str);
+  if (fits(n) == false) {
+    return false;
+  }
+  memcpy_P(buffer + end, str, n + 1);
+  end += n;
+  return true;
+}
+
+/*
+   Add a single character.
+*/
+bool HydroMonitorQueryBuilder::add(char c) {
+  if (fits(1) == false) {
+    return false;
+  }
+  buffer[end++] = c;
+  buffer[end] = 0;
+  return true;
+}
+
+/********************************************************************************************************************
+   Add str, URL encoded. With partial set as much of it is added as fits; otherwise all or nothing.
+*/
+bool HydroMonitorQueryBuilder::addEncoded(const char* str, bool partial) {
+  static const char hex[] PROGMEM = "0123456789ABCDEF";
+  uint16_t start = end;
+  for (const char* c = str; *c; c++) {
+    bool plain = isalnum((uint8_t)*c) || *c == ' ';
+    if (fits((plain) ? 1 : 3) == false) {
+      if (partial) {
+        buffer[end] = 0;
+      }
+      else {
+        reset(start);                                       // All or nothing.
+        overflowed = true;
+      }
+      return false;
+    }
+    if (plain) {
+      buffer[end++] = (*c == ' ') ? '+' : *c;
+    }
+    else {
+      buffer[end++] = '%';
+      buffer[end++] = pgm_read_byte(&hex[(*c >> 4) & 0x0F]);
+      buffer[end++] = pgm_read_byte(&hex[*c & 0x0F]);
+    }
+  }
+  buffer[end] = 0;
+  return true;
+}
+
+/********************************************************************************************************************
+   Add a number, in decimal.
+*/
+bool HydroMonitorQueryBuilder::addUnsigned(uint32_t value) {
+  char digits[10];                                          // Backwards.
+  uint8_t n = 0;
+  do {
+    digits[n++] = '0' + value % 10;
+    value /= 10;
+  } while (value > 0);
+  if (fits(n) == false) {
+    return false;
+  }
+  while (n > 0) {
+    buffer[end++] = digits[--n];
+  }
+  buffer[end] = 0;
+  return true;
+}
+
+/********************************************************************************************************************
+   Add a number with the given number of decimals.
+*/
+bool HydroMonitorQueryBuilder::addFloat(float value, uint8_t decimals) {
+  uint16_t room = size - end;
+  uint16_t n = snprintf_P(buffer + end, room, PSTR("%.*f"), decimals, value);
+  if (n >= room) {                                          // Didn't fit: take it back.
+    buffer[end] = 0;
+    overflowed = true;
+    return false;
+  }
+  end += n;
+  return true;
+}
+
+/********************************************************************************************************************
+   Add the parameter name=value, with the value URL encoded. With partial set as much of the value is added as
+   fits.
+*/
+bool HydroMonitorQueryBuilder::addParameter(PGM_P name, const char* value, bool partial) {
+  uint16_t start = end;
+  if (startParameter(name) == false) {
+    reset(start);
+    overflowed = true;
+    return false;
+  }
+  if (addEncoded(value, partial)) {
+    return true;
+  }
+  if (partial == false) {
+    reset(start);
+    overflowed = true;
+  }
+  return false;
+}
+
+bool HydroMonitorQueryBuilder::addParameter(PGM_P name, uint32_t value) {
+  uint16_t start = end;
+  if (startParameter(name) && addUnsigned(value)) {
+    return true;
+  }
+  reset(start);
+  overflowed = true;
+  return false;
+}
+
+bool HydroMonitorQueryBuilder::addParameter(PGM_P name, float value, uint8_t decimals) {
+  uint16_t start = end;
+  if (startParameter(name) && addFloat(value, decimals)) {
+    return true;
+  }
+  reset(start);
+  overflowed = true;
+  return false;
+}
+
+/********************************************************************************************************************
+   The current length, to reset() to later.
+*/
+uint16_t HydroMonitorQueryBuilder::mark() {
+  return end;
+}
+
+/*
+   Take back everything added after the mark; clears the overflow.
+*/
+void HydroMonitorQueryBuilder::reset(uint16_t m) {
+  end = min(m, end);
+  buffer[end] = 0;
+  overflowed = false;
+}
+
+/*
+   Length of the string.
+*/
+uint16_t HydroMonitorQueryBuilder::length() {
+  return end;
+}
+
+/*
+   Whether something didn't fit since the start, or the latest reset().
+*/
+bool HydroMonitorQueryBuilder::overflow() {
+  return overflowed;
+}
+
+/*
+   The string.
+*/
+char* HydroMonitorQueryBuilder::c_str() {
+  return buffer;
+}
+
+/********************************************************************************************************************
+   Add the separator (if needed), the parameter name and the = sign.
+*/
+bool HydroMonitorQueryBuilder::startParameter(PGM_P name) {
+  if (end > 0 && buffer[end - 1] != '?' && add('&') == false) {
+    return false;
+  }
+  return add_P(name) && add('=');
+}
+
+/*
+   Whether n more characters fit, with the null terminator. If not, the overflow is set.
+*/
+bool HydroMonitorQueryBuilder::fits(uint16_t n) {
+  if (end + n + 1 > size) {
+    overflowed = true;
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,53 @@
+/*
+   HydroMonitorQueryBuilder
+
+   Builds a URL query string - or a line of a batch upload, which has the same format - in a buffer owned by the
+   caller.
+
+   The builder is append only, and keeps track of the end of the string, so the string is never scanned again.
+   Parameter values are URL encoded (spaces as +, everything but letters and digits as %xx, as done by
+   HydroMonitorCore::urlencode()) and numbers formatted straight into the buffer: nothing is allocated on the heap.
+
+   Nothing is ever written past the end of the buffer, and the string is always null terminated. Whatever doesn't
+   fit completely is not added at all, and overflow() is set; with partial set, addParameter() adds as much of an
+   encoded string as fits instead, but never half a %xx code. mark() and reset() take back what was added after
+   the mark, e.g. a batch line that turned out not to fit.
+
+   addParameter() puts the & separator in front of the parameter, except at the start of the string or after a ?.
+
+*/
+
+#ifndef HYDROMONITORQUERYBUILDER_H
+#define HYDROMONITORQUERYBUILDER_H
+
+#include <Arduino.h>
+
+class HydroMonitorQueryBuilder
+{
+  public:
+    HydroMonitorQueryBuilder(char*, uint16_t);
+    bool add(const char*);
+    bool add_P(PGM_P);
+    bool add(char);
+    bool addEncoded(const char*, bool = false);
+    bool addUnsigned(uint32_t);
+    bool addFloat(float, uint8_t);
+    bool addParameter(PGM_P, const char*, bool = false);
+    bool addParameter(PGM_P, uint32_t);
+    bool addParameter(PGM_P, float, uint8_t);
+    uint16_t mark();
+    void reset(uint16_t = 0);
+    uint16_t length();
+    bool overflow();
+    char* c_str();
+
+  private:
+    bool startParameter(PGM_P);
+    bool fits(uint16_t);
+
+    char* buffer;
+    uint16_t size;                                          // Size of the buffer, including the null terminator.
+    uint16_t end = 0;                                       // Length of the string.
+    bool overflowed = false;
+};
+#endif
@@ -0,0 +1,29 @@
+#include <HydroMonitorRamLogStorage.h>
+
+/*
+   Log segments in RAM.
+*/
+
+/*
+   The constructor: the segments are stored in buffer, of s bytes.
+*/
+HydroMonitorRamLogStorage::HydroMonitorRamLogStorage(uint8_t* b, uint32_t s) : HydroMonitorSlotLogStorage(s) {
+  buffer = b;
+  size = s;
+}
+
+/*
+   Start with an empty store: whatever is in the buffer is not ours.
+*/
+void HydroMonitorRamLogStorage::begin(const char* name) {
+  memset(buffer, 0, min(size, (uint32_t)SLOT_TABLE_ALIGN));
+  HydroMonitorSlotLogStorage::begin(name);
+}
+
+void HydroMonitorRamLogStorage::readRaw(uint32_t address, uint8_t* data, uint16_t n) {
+  memcpy(data, buffer + address, n);
+}
+
+void HydroMonitorRamLogStorage::writeRaw(uint32_t address, const uint8_t* data, uint16_t n) {
+  memcpy(buffer + address, data, n);
+}
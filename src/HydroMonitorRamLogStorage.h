@@ -0,0 +1,32 @@
+/*
+   HydroMonitorRamLogStorage
+
+   Log segments in a RAM buffer owned by the caller (see HydroMonitorSlotLogStorage). Nothing survives a reset:
+   begin() starts with an empty store. It uses nothing but the buffer, so it runs anywhere - to test the logging
+   on a host, or to compare the Flash and EEPROM storages against.
+
+   The buffer holds the slot table followed by the slots; a buffer of n * LOG_SEGMENT_SIZE + SLOT_TABLE_ALIGN bytes
+   holds n segments.
+
+*/
+
+#ifndef HYDROMONITORRAMLOGSTORAGE_H
+#define HYDROMONITORRAMLOGSTORAGE_H
+
+#include <HydroMonitorSlotLogStorage.h>
+
+class HydroMonitorRamLogStorage : public HydroMonitorSlotLogStorage
+{
+  public:
+    HydroMonitorRamLogStorage(uint8_t*, uint32_t);
+    void begin(const char*);
+
+  protected:
+    void readRaw(uint32_t, uint8_t*, uint16_t);
+    void writeRaw(uint32_t, const uint8_t*, uint16_t);
+
+  private:
+    uint8_t* buffer;
+    uint32_t size;
+};
+#endif
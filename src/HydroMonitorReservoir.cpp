@@ -21,7 +21,7 @@ HydroMonitorReservoir::HydroMonitorReservoir() {
 void HydroMonitorReservoir::begin(HydroMonitorCore::SensorData *sd, HydroMonitorLogging *l, Adafruit_MCP23017* mcp23017, HydroMonitorWaterLevelSensor* sens) {
   mcp = mcp23017;
   mcp->pinMode(WATER_INLET_MCP17_PIN, INPUT);
-  l->writeTrace(F("HydroMonitorReservoir: configured reservoir refill on MCP23017 port expander."));
+  l->writeTrace(LOG_MODULE_RESERVOIR, F("HydroMonitorReservoir: configured reservoir refill on MCP23017 port expander."));
 
   /*
      Set up the solenoid, connected to a MCP23008 port expander.
@@ -30,7 +30,7 @@ void HydroMonitorReservoir::begin(HydroMonitorCore::SensorData *sd, HydroMonitor
 void HydroMonitorReservoir::begin(HydroMonitorCore::SensorData * sd, HydroMonitorLogging * l, Adafruit_MCP23008 * mcp23008, HydroMonitorWaterLevelSensor * sens) {
   mcp = mcp23008;
   mcp->pinMode(WATER_INLET_MCP_PIN, INPUT);
-  l->writeTrace(F("HydroMonitorReservoir: configured reservoir refill on MCP23008 port expander."));
+  l->writeTrace(LOG_MODULE_RESERVOIR, F("HydroMonitorReservoir: configured reservoir refill on MCP23008 port expander."));
 
   /*
      Set up the solenoid, connected to a PCF8574 port expander.
@@ -39,7 +39,7 @@ void HydroMonitorReservoir::begin(HydroMonitorCore::SensorData * sd, HydroMonito
 void HydroMonitorReservoir::begin(HydroMonitorCore::SensorData * sd, HydroMonitorLogging * l, PCF857x * pcf, HydroMonitorWaterLevelSensor * sens) {
   pcf8574 = pcf;
   pcf8574->pinMode(WATER_INLET_PCF_PIN, INPUT);
-  l->writeTrace(F("HydroMonitorReservoir: configured reservoir refill on PCF8574 port expander."));
+  l->writeTrace(LOG_MODULE_RESERVOIR, F("HydroMonitorReservoir: configured reservoir refill on PCF8574 port expander."));
 
   /*
      Set up the solenoid, connected to a GPIO port.
@@ -47,7 +47,7 @@ void HydroMonitorReservoir::begin(HydroMonitorCore::SensorData * sd, HydroMonito
 #elif defined(WATER_INLET_PIN)
 void HydroMonitorReservoir::begin(HydroMonitorCore::SensorData * sd, HydroMonitorLogging * l, HydroMonitorWaterLevelSensor * sens) {
   pinMode(WATER_INLET_PIN, INPUT);
-  l->writeTrace(F("HydroMonitorReservoir: configured reservoir refill."));
+  l->writeTrace(LOG_MODULE_RESERVOIR, F("HydroMonitorReservoir: configured reservoir refill."));
 #endif
   waterLevelSensor = sens;
   reservoirEmptyTime = millis();
@@ -58,7 +58,7 @@ void HydroMonitorReservoir::begin(HydroMonitorCore::SensorData * sd, HydroMonito
 void HydroMonitorReservoir::begin(HydroMonitorCore::SensorData *sd, HydroMonitorLogging *l, Adafruit_MCP23017* mcp23017) {
   mcp = mcp23017;
   mcp->pinMode(WATER_INLET_MCP17_PIN, INPUT);
-  l->writeTrace(F("HydroMonitorReservoir: configured reservoir refill on MCP23017 port expander."));
+  l->writeTrace(LOG_MODULE_RESERVOIR, F("HydroMonitorReservoir: configured reservoir refill on MCP23017 port expander."));
 
   /*
      Set up the solenoid, connected to a MCP23008 port expander.
@@ -67,7 +67,7 @@ void HydroMonitorReservoir::begin(HydroMonitorCore::SensorData *sd, HydroMonitor
 void HydroMonitorReservoir::begin(HydroMonitorCore::SensorData * sd, HydroMonitorLogging * l, Adafruit_MCP23008 * mcp23008) {
   mcp = mcp23008;
   mcp->pinMode(WATER_INLET_MCP_PIN, INPUT);
-  l->writeTrace(F("HydroMonitorReservoir: configured reservoir refill on MCP23008 port expander."));
+  l->writeTrace(LOG_MODULE_RESERVOIR, F("HydroMonitorReservoir: configured reservoir refill on MCP23008 port expander."));
 
   /*
      Set up the solenoid, connected to a PCF8574 port expander.
@@ -76,7 +76,7 @@ void HydroMonitorReservoir::begin(HydroMonitorCore::SensorData * sd, HydroMonito
 void HydroMonitorReservoir::begin(HydroMonitorCore::SensorData * sd, HydroMonitorLogging * l, PCF857x * pcf) {
   pcf8574 = pcf;
   pcf8574->pinMode(WATER_INLET_PCF_PIN, INPUT);
-  l->writeTrace(F("HydroMonitorReservoir: configured reservoir refill on PCF8574 port expander."));
+  l->writeTrace(LOG_MODULE_RESERVOIR, F("HydroMonitorReservoir: configured reservoir refill on PCF8574 port expander."));
 
   /*
      Set up the solenoid, connected to a GPIO port.
@@ -84,7 +84,7 @@ void HydroMonitorReservoir::begin(HydroMonitorCore::SensorData * sd, HydroMonito
 #elif defined(WATER_INLET_PIN)
 void HydroMonitorReservoir::begin(HydroMonitorCore::SensorData * sd, HydroMonitorLogging * l) {
   pinMode(WATER_INLET_PIN, INPUT);
-  l->writeTrace(F("HydroMonitorReservoir: configured reservoir refill."));
+  l->writeTrace(LOG_MODULE_RESERVOIR, F("HydroMonitorReservoir: configured reservoir refill."));
 #endif
   bitSet(sd->systemStatus, STATUS_RESERVOIR_DRAINED); // We don't know the reservoir level: assume empty & start filling.
 #endif
@@ -99,7 +99,7 @@ void HydroMonitorReservoir::begin(HydroMonitorCore::SensorData * sd, HydroMonito
 #endif
 
   if (settings.maxFill > 100) {
-    logging->writeTrace(F("HydroMonitorReservoir: applying default settings."));
+    logging->writeTrace(LOG_MODULE_RESERVOIR, F("HydroMonitorReservoir: applying default settings."));
     settings.maxFill = 90;
     settings.minFill = 70;
 #ifdef USE_24LC256_EEPROM
@@ -149,7 +149,7 @@ void HydroMonitorReservoir::doReservoir() {
       beep = false;
     }
     if (millis() - lastWarned > WARNING_INTERVAL) {
-      logging->writeError(F("Reservoir 10: float switch triggered, reservoir water level is critically high."));
+      logging->writeError(MESSAGE_RESERVOIR_10);
       lastWarned = millis();
     }
   }
@@ -185,7 +185,7 @@ void HydroMonitorReservoir::doReservoir() {
     startAddWater = millis();
     lastLevelCheck = millis();
     waterLevelSensor->readSensor(true);
-    logging->writeTrace(F("HydroMonitorReservoir: No water level detected for half a minute, opening water inlet valve for 30 seconds to try and get the water level sensor to react."));
+    logging->writeTrace(LOG_MODULE_RESERVOIR, F("HydroMonitorReservoir: No water level detected for half a minute, opening water inlet valve for 30 seconds to try and get the water level sensor to react."));
   }
   else if (initialFillingInProgress) {                      // We're trying to add some water to the reservoir.
     if (millis() - lastLevelCheck > 500) {                  // Check the sensor every 0.5 seconds.
@@ -196,7 +196,7 @@ void HydroMonitorReservoir::doReservoir() {
         || sensorData->waterLevel > 0) {                    // if we actually have a reading, we can stop this.
       initialFillingInProgress = false;
       closeValve();
-      logging->writeTrace(F("HydroMonitorReservoir: Initial filling done."));
+      logging->writeTrace(LOG_MODULE_RESERVOIR, F("HydroMonitorReservoir: Initial filling done."));
     }
   }
   else {
@@ -207,11 +207,11 @@ void HydroMonitorReservoir::doReservoir() {
       }
       if (sensorData->waterLevel > settings.maxFill) {      // If we have enough water in the reservoir, close the valve.
         closeValve();
-        logging->writeTrace(F("HydroMonitorReservoir: water level high enough, closing the valve."));
+        logging->writeTrace(LOG_MODULE_RESERVOIR, F("HydroMonitorReservoir: water level high enough, closing the valve."));
       }
       if (millis() - startAddWater > 3 * 60 * 1000ul) {     // As extra safety measure: close the valve after 3 minutes, regardless of what the water level sensor says.
         closeValve();
-        logging->writeWarning(F("HydroMonitorReservoir: added water for 3 minutes, high level not reached, timeout: closing the valve."));
+        logging->writeWarning(LOG_MODULE_RESERVOIR, F("HydroMonitorReservoir: added water for 3 minutes, high level not reached, timeout: closing the valve."));
         lastGoodFill = millis() + 60 * 60 * 1000ul;         // Call it a good fill, and set the time an hour in the future: no trying to fill before that time.
       }
     }
@@ -227,13 +227,13 @@ void HydroMonitorReservoir::doReservoir() {
       else if (millis() - startAddWater < 30 * 60 * 1000ul) { // Less than 30 minutes after filling we're low already? That's odd!
         if (millis() - lastWarned > WARNING_INTERVAL) {
           lastWarned = millis();
-          logging->writeError(F("Reservoir 11: shortly after the reservoir was topped up, water level dropped below the minimum already."));
+          logging->writeError(MESSAGE_RESERVOIR_11);
         }
       }
       else if (millis() - lastGoodFill > 1 * 60 * 1000ul && // If water too low for more than 1 minute,
                sensorData->waterLevel > 0) {                // and the water sensor actually gives a reading, start filling.
-        logging->writeTrace(F("HydroMonitorReservoir: water level too low for 1 minute, opening the valve."));
-        logging->writeInfo(F("HydroMonitorReservoir: adding water to the reservoir."));
+        logging->writeTrace(LOG_MODULE_RESERVOIR, F("HydroMonitorReservoir: water level too low for 1 minute, opening the valve."));
+        logging->writeInfo(LOG_MODULE_RESERVOIR, F("HydroMonitorReservoir: adding water to the reservoir."));
         openValve();
         lastLevelCheck = millis();
         startAddWater = millis();
@@ -247,14 +247,14 @@ void HydroMonitorReservoir::doReservoir() {
   }
   if (sensorData->waterLevel > settings.maxFill + 5 &&
       millis() - startAddWater < 5 * 60 * 1000ul) {
-    logging->writeError(F("Reservoir 12: water level >5% over maxFill within 5 minutes of starting to fill the reservoir. Suspected problem with the filling system."));
+    logging->writeError(MESSAGE_RESERVOIR_12);
   }
   if (sensorData->waterLevel > 100) {                       // Very full reservoir; should have been drained already.
     if (millis() - lastWarned > WARNING_INTERVAL) {
       lastWarned = millis();
       char buff[80];
       sprintf_P(buff, PSTR("HydroMonitorReservoir: water level too high: current level %3.1f%."), sensorData->waterLevel);
-      logging->writeWarning(buff);
+      logging->writeWarning(LOG_MODULE_RESERVOIR, buff);
     }
   }
 #else
@@ -263,21 +263,21 @@ void HydroMonitorReservoir::doReservoir() {
     bitClear(sensorData->systemStatus, STATUS_RESERVOIR_DRAINED); // We're filling, so not drained any more. Clear the flag.
     startAddWater = millis();
     isWeeklyTopUp = false;
-    logging->writeTrace(F("HydroMonitorReservoir: Reservoir empty after draining; filling with water."));
+    logging->writeTrace(LOG_MODULE_RESERVOIR, F("HydroMonitorReservoir: Reservoir empty after draining; filling with water."));
   }
   else if (millis() - startAddWater > 7 * 24 * 60 * 60 * 1000ul) { // Every 7 days: do a reservoir top-up.
     openValve();
     bitClear(sensorData->systemStatus, STATUS_RESERVOIR_DRAINED); // We're filling, so not drained any more. Clear the flag.
     startAddWater = millis();
     isWeeklyTopUp = true;
-    logging->writeTrace(F("HydroMonitorReservoir: Doing weekly reservoir top-up."));
+    logging->writeTrace(LOG_MODULE_RESERVOIR, F("HydroMonitorReservoir: Doing weekly reservoir top-up."));
   }
   else if (bitRead(sensorData->systemStatus, STATUS_FILLING_RESERVOIR)) { // Reservoir is being filled.
     if ((isWeeklyTopUp && millis() - startAddWater > 3 * 60 * 1000ul) || // Weekly top-up for 3 minutes, or
         millis() - startAddWater > 20 * 60 * 1000ul) {      // 20 minutes for a complete fill.
       closeValve();
       bitClear(sensorData->systemStatus, STATUS_RESERVOIR_LEVEL_LOW); // It's for sure filled up now.
-      logging->writeInfo(F("HydroMonitorReservoir: finished adding water, closing the valve."));
+      logging->writeInfo(LOG_MODULE_RESERVOIR, F("HydroMonitorReservoir: finished adding water, closing the valve."));
     }
   }
 #endif
@@ -0,0 +1,156 @@
+#include <HydroMonitorSlotLogStorage.h>
+
+/*
+   Log segments in slots of a flat memory.
+*/
+
+/*
+   The constructor: size is the number of bytes of memory available.
+*/
+HydroMonitorSlotLogStorage::HydroMonitorSlotLogStorage(uint32_t size) {
+  nSlots = min((uint32_t)MAX_LOG_SLOTS, (uint32_t)(size / (LOG_SEGMENT_SIZE + sizeof(SlotEntry))));
+  slotStart = (nSlots * sizeof(SlotEntry) + SLOT_TABLE_ALIGN - 1) / SLOT_TABLE_ALIGN * SLOT_TABLE_ALIGN;
+  if (nSlots > 0 && slotStart + nSlots * LOG_SEGMENT_SIZE > size) { // Padding of the table takes the space of a slot.
+    nSlots--;
+  }
+}
+
+/*
+   Read the slot table. The name is not used: the memory holds a single store.
+*/
+void HydroMonitorSlotLogStorage::begin(const char* name) {
+  readRaw(0, (uint8_t*)slot, nSlots * sizeof(SlotEntry));
+  for (uint8_t i = 0; i < nSlots; i++) {
+    if (slot[i].check != entryCheck(&slot[i]) || slot[i].length > LOG_SEGMENT_SIZE) {
+      slot[i].segment = FREE_SLOT;
+    }
+  }
+}
+
+/*
+   List the segments stored: the next one each call, or with restart set the first one again.
+   Returns false if there are no more.
+*/
+bool HydroMonitorSlotLogStorage::nextSegment(bool restart, uint32_t* segment, uint16_t* length) {
+  if (restart) {
+    listed = 0;
+  }
+  while (listed < nSlots) {
+    SlotEntry* entry = &slot[listed++];
+    if (entry->segment != FREE_SLOT) {
+      *segment = entry->segment;
+      *length = entry->length;
+      return true;
+    }
+  }
+  return false;
+}
+
+/*
+   All slots are for this store, whatever its share.
+*/
+uint32_t HydroMonitorSlotLogStorage::capacity(uint8_t share) {
+  return nSlots * LOG_SEGMENT_SIZE;
+}
+
+/*
+   There's no room for more segments than slots.
+*/
+bool HydroMonitorSlotLogStorage::canGrow() {
+  return false;
+}
+
+/*
+   Append size bytes to the end of segment; if it's a new segment, it's put in a free slot.
+   Returns false if there's no free slot, or no room in the segment.
+*/
+bool HydroMonitorSlotLogStorage::append(uint32_t segment, const uint8_t* data, uint16_t size) {
+  int8_t i = findSlot(segment);
+  if (i < 0) {                                              // A new segment.
+    i = findSlot(FREE_SLOT);
+    if (i < 0) {
+      return false;
+    }
+    slot[i].segment = segment;
+    slot[i].length = 0;
+  }
+  if (slot[i].length + size > LOG_SEGMENT_SIZE) {
+    return false;
+  }
+  writeRaw(slotAddress(i) + slot[i].length, data, size);
+  slot[i].length += size;
+  writeEntry(i);                                            // The record is there before its length is.
+  bytesWritten += size;
+  return true;
+}
+
+/*
+   Read up to size bytes from segment, starting at offset.
+   Returns the number of bytes read.
+*/
+uint16_t HydroMonitorSlotLogStorage::read(uint32_t segment, uint16_t offset, uint8_t* buffer, uint16_t size) {
+  int8_t i = findSlot(segment);
+  if (i < 0 || offset >= slot[i].length) {
+    return 0;
+  }
+  size = min(size, (uint16_t)(slot[i].length - offset));
+  readRaw(slotAddress(i) + offset, buffer, size);
+  return size;
+}
+
+/*
+   Cut segment off after length bytes.
+*/
+void HydroMonitorSlotLogStorage::cut(uint32_t segment, uint16_t length) {
+  int8_t i = findSlot(segment);
+  if (i >= 0 && length < slot[i].length) {
+    slot[i].length = length;
+    writeEntry(i);
+  }
+}
+
+/*
+   Remove segment: free its slot.
+*/
+void HydroMonitorSlotLogStorage::remove(uint32_t segment) {
+  int8_t i = findSlot(segment);
+  if (i >= 0) {
+    slot[i].segment = FREE_SLOT;
+    writeEntry(i);
+  }
+}
+
+/*
+   The slot holding segment; -1 if there's none.
+*/
+int8_t HydroMonitorSlotLogStorage::findSlot(uint32_t segment) {
+  for (uint8_t i = 0; i < nSlots; i++) {
+    if (slot[i].segment == segment) {
+      return i;
+    }
+  }
+  return -1;
+}
+
+/*
+   Write the table entry of slot i to the memory.
+*/
+void HydroMonitorSlotLogStorage::writeEntry(uint8_t i) {
+  slot[i].check = entryCheck(&slot[i]);
+  writeRaw(i * sizeof(SlotEntry), (uint8_t*)&slot[i], sizeof(SlotEntry));
+  bytesWritten += sizeof(SlotEntry);
+}
+
+/*
+   The check word of a table entry. It doesn't match for an entry of all 0x00 or all 0xFF bytes.
+*/
+uint16_t HydroMonitorSlotLogStorage::entryCheck(SlotEntry* entry) {
+  return (entry->segment ^ (entry->segment >> 16) ^ entry->length ^ 0xA55A) & 0xFFFF;
+}
+
+/*
+   Address of the first byte of slot i.
+*/
+uint32_t HydroMonitorSlotLogStorage::slotAddress(uint8_t i) {
+  return slotStart + i * LOG_SEGMENT_SIZE;
+}
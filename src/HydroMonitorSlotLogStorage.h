@@ -0,0 +1,67 @@
+/*
+   HydroMonitorSlotLogStorage
+
+   Log segments in a flat, byte addressable memory: RAM or an EEPROM. The derived classes only read and write
+   bytes at an address (readRaw(), writeRaw()); this class divides the memory into slots of LOG_SEGMENT_SIZE
+   bytes and keeps track of which segment is in which slot.
+
+   Memory layout:
+    - the slot table: one 8-byte entry per slot, padded to SLOT_TABLE_ALIGN bytes. Each entry holds the segment
+      number, the number of bytes stored in it, and a check word; a slot with an entry that doesn't check out is
+      free, so an erased (0xFF) or zeroed memory holds no segments.
+    - the slots, each LOG_SEGMENT_SIZE bytes. They start at a multiple of SLOT_TABLE_ALIGN, so a slot starts at a
+      page boundary of the EEPROM.
+
+   Every append writes the record, followed by the slot's table entry with the new length. A segment is removed by
+   freeing its slot; nothing is erased.
+
+   The store may use all slots, whatever its share: the memory is its own. As there is no room for more segments
+   than slots, a store can't keep more segments than that.
+
+*/
+
+#ifndef HYDROMONITORSLOTLOGSTORAGE_H
+#define HYDROMONITORSLOTLOGSTORAGE_H
+
+#include <HydroMonitorLogStorage.h>
+#include <HydroMonitorLogStore.h>
+
+const uint8_t MAX_LOG_SLOTS = 8;                            // Slots of a slotted storage.
+const uint8_t SLOT_TABLE_ALIGN = 64;                        // Alignment of the slots: the EEPROM page size.
+const uint32_t FREE_SLOT = 0xFFFFFFFF;                      // Segment number of a free slot.
+
+class HydroMonitorSlotLogStorage : public HydroMonitorLogStorage
+{
+  public:
+    HydroMonitorSlotLogStorage(uint32_t);
+    void begin(const char*);
+    bool nextSegment(bool, uint32_t*, uint16_t*);
+    uint32_t capacity(uint8_t);
+    bool canGrow();
+    bool append(uint32_t, const uint8_t*, uint16_t);
+    uint16_t read(uint32_t, uint16_t, uint8_t*, uint16_t);
+    void cut(uint32_t, uint16_t);
+    void remove(uint32_t);
+
+  protected:
+    virtual void readRaw(uint32_t, uint8_t*, uint16_t) = 0;
+    virtual void writeRaw(uint32_t, const uint8_t*, uint16_t) = 0;
+
+  private:
+    struct SlotEntry {
+      uint32_t segment;                                     // Segment stored in this slot; FREE_SLOT if none.
+      uint16_t length;                                      // Bytes stored.
+      uint16_t check;                                       // Check word of segment and length.
+    } __attribute__((packed));
+
+    int8_t findSlot(uint32_t);
+    void writeEntry(uint8_t);
+    uint16_t entryCheck(SlotEntry*);
+    uint32_t slotAddress(uint8_t);
+
+    uint8_t nSlots;
+    uint32_t slotStart;                                     // Address of the first slot.
+    SlotEntry slot[MAX_LOG_SLOTS];                          // Copy of the slot table.
+    uint8_t listed;                                         // Slots listed by nextSegment().
+};
+#endif
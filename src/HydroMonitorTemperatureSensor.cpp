@@ -18,7 +18,7 @@ void HydroMonitorTemperatureSensor::begin(HydroMonitorCore::SensorData *sd, Hydr
   dht22 = dht;
   logging = l;
   sensorData = sd;
-  logging->writeTrace(F("HydroMonitorTemperatureSensor: configured DHT22 sensor."));
+  logging->writeTrace(LOG_MODULE_TEMPERATURESENSOR, F("HydroMonitorTemperatureSensor: configured DHT22 sensor."));
   if (TEMPERATURE_SENSOR_EEPROM > 0) {
     EEPROM.get(TEMPERATURE_SENSOR_EEPROM, settings);
   }
@@ -31,7 +31,7 @@ void HydroMonitorTemperatureSensor::begin(HydroMonitorCore::SensorData *sd, Hydr
 #ifdef USE_BMP180
 void HydroMonitorTemperatureSensor::begin(HydroMonitorCore::SensorData *sd, HydroMonitorLogging *l, BMP180 *bmp) {
   bmp180 = bmp;
-  l->writeTrace(F("HydroMonitorTemperatureSensor: configured BMP180 sensor."));
+  l->writeTrace(LOG_MODULE_TEMPERATURESENSOR, F("HydroMonitorTemperatureSensor: configured BMP180 sensor."));
 
   /*
      Configure the sensor as BMP280 or BME280.
@@ -39,7 +39,7 @@ void HydroMonitorTemperatureSensor::begin(HydroMonitorCore::SensorData *sd, Hydr
 #elif defined(USE_BMP280) || defined(USE_BME280)
 void HydroMonitorTemperatureSensor::begin(HydroMonitorCore::SensorData * sd, HydroMonitorLogging * l, BME280 * bmp) {
   bmp280 = bmp;
-  l->writeTrace(F("HydroMonitorTemperatureSensor: configured BMP280 sensor."));
+  l->writeTrace(LOG_MODULE_TEMPERATURESENSOR, F("HydroMonitorTemperatureSensor: configured BMP280 sensor."));
 #endif
 
 #if defined(USE_BMP180) || defined(USE_BMP280) || defined(USE_BME280)
@@ -70,7 +70,7 @@ void HydroMonitorTemperatureSensor::readSensor(bool readNow) {
         millis() - lastWarned > WARNING_INTERVAL) {
       char buff[90];
       sprintf_P(buff, PSTR("HydroMonitorTemperatureSensor: unusual temperature of %2.2f°C measured."), sensorData->temperature);
-      logging->writeWarning(buff);
+      logging->writeWarning(LOG_MODULE_TEMPERATURESENSOR, buff);
       lastWarned = millis();
     }
   }
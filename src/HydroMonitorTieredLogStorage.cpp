@@ -0,0 +1,148 @@
+#include <HydroMonitorTieredLogStorage.h>
+
+/*
+   Log segments in a hot and a cold storage.
+*/
+
+/*
+   The constructor: h is the hot storage, c the cold storage.
+*/
+HydroMonitorTieredLogStorage::HydroMonitorTieredLogStorage(HydroMonitorLogStorage* h, HydroMonitorLogStorage* c) {
+  hot = h;
+  cold = c;
+}
+
+/*
+   Open both storages, and find the newest segment in each.
+*/
+void HydroMonitorTieredLogStorage::begin(const char* dir) {
+  hot->begin(dir);
+  cold->begin(dir);
+  hotHead = NO_SEGMENT;
+  coldHead = NO_SEGMENT;
+  uint32_t segment;
+  uint16_t length;
+  for (bool restart = true; hot->nextSegment(restart, &segment, &length); restart = false) {
+    if (hotHead == NO_SEGMENT || segment > hotHead) {
+      hotHead = segment;
+    }
+  }
+  for (bool restart = true; cold->nextSegment(restart, &segment, &length); restart = false) {
+    if (coldHead == NO_SEGMENT || segment > coldHead) {
+      coldHead = segment;
+    }
+  }
+}
+
+/*
+   List the segments: those of the cold storage, then those of the hot storage. A segment in both is listed twice;
+   the hot one, which is complete, comes last.
+*/
+bool HydroMonitorTieredLogStorage::nextSegment(bool restart, uint32_t* segment, uint16_t* length) {
+  if (restart) {
+    listingHot = false;
+  }
+  if (listingHot == false) {
+    if (cold->nextSegment(restart, segment, length)) {
+      return true;
+    }
+    listingHot = true;
+    restart = true;
+  }
+  return hot->nextSegment(restart, segment, length);
+}
+
+uint32_t HydroMonitorTieredLogStorage::capacity(uint8_t share) {
+  return cold->capacity(share);
+}
+
+bool HydroMonitorTieredLogStorage::canGrow() {
+  return cold->canGrow();
+}
+
+/*
+   Append size bytes to the end of segment. A new segment goes to the hot storage, after what's there is spilled.
+   Returns false if not all bytes could be written.
+*/
+bool HydroMonitorTieredLogStorage::append(uint32_t segment, const uint8_t* data, uint16_t size) {
+  bool success;
+  if (segment != hotHead && coldHead != NO_SEGMENT && segment <= coldHead) { // A segment that's in the cold storage.
+    success = cold->append(segment, data, size);
+  }
+  else {
+    if (segment != hotHead) {                               // A new segment.
+      spill();
+      hotHead = segment;
+    }
+    success = hot->append(segment, data, size);
+    if (success == false) {                                 // Hot storage failed: keep the record in the cold one.
+      spill();
+      coldHead = segment;
+      success = cold->append(segment, data, size);
+    }
+  }
+  bytesWritten = hot->bytesWritten + cold->bytesWritten;
+  return success;
+}
+
+/*
+   Read up to size bytes from segment, starting at offset: from the hot storage if it has them.
+   Returns the number of bytes read.
+*/
+uint16_t HydroMonitorTieredLogStorage::read(uint32_t segment, uint16_t offset, uint8_t* buffer, uint16_t size) {
+  uint16_t n = 0;
+  if (segment == hotHead) {
+    n = hot->read(segment, offset, buffer, size);
+  }
+  if (n == 0) {
+    n = cold->read(segment, offset, buffer, size);
+  }
+  return n;
+}
+
+/*
+   Cut segment off after length bytes.
+*/
+void HydroMonitorTieredLogStorage::cut(uint32_t segment, uint16_t length) {
+  if (segment == hotHead) {
+    hot->cut(segment, length);
+  }
+  else {
+    cold->cut(segment, length);
+  }
+  bytesWritten = hot->bytesWritten + cold->bytesWritten;
+}
+
+/*
+   Remove segment from both storages.
+*/
+void HydroMonitorTieredLogStorage::remove(uint32_t segment) {
+  hot->remove(segment);
+  cold->remove(segment);
+  if (segment == hotHead) {
+    hotHead = NO_SEGMENT;
+  }
+  bytesWritten = hot->bytesWritten + cold->bytesWritten;
+}
+
+/*
+   Copy the segments of the hot storage to the cold storage, and remove them from the hot storage.
+*/
+void HydroMonitorTieredLogStorage::spill() {
+  uint32_t segment;
+  uint16_t length;
+  uint8_t block[TIER_SPILL_BLOCK];
+  while (hot->nextSegment(true, &segment, &length)) {
+    cold->remove(segment);                                  // Left-over of a spill that was interrupted.
+    for (uint16_t offset = 0; offset < length; offset += TIER_SPILL_BLOCK) {
+      uint16_t n = hot->read(segment, offset, block, TIER_SPILL_BLOCK);
+      cold->append(segment, block, n);
+      yield();
+    }
+    hot->remove(segment);
+    if (coldHead == NO_SEGMENT || segment > coldHead) {
+      coldHead = segment;
+    }
+  }
+  hotHead = NO_SEGMENT;
+}
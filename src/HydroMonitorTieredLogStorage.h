@@ -0,0 +1,51 @@
+/*
+   HydroMonitorTieredLogStorage
+
+   Log segments in two tiers: the head segment, which takes every new record, in a hot storage that doesn't mind
+   many small writes (the 24LC256 EEPROM); the complete segments in a cold storage (the file system).
+
+   When the store starts a new segment, the segments in the hot storage are copied to the cold storage - in
+   blocks of TIER_SPILL_BLOCK bytes, so a few large writes instead of one per record - and removed from the hot
+   storage. So the cold storage is written once per LOG_SEGMENT_SIZE bytes of records, not once per record.
+
+   A power cut while spilling leaves the segment in both tiers; the hot copy is complete, so it's the one that's
+   read, and the next spill starts the copy over. A head segment that is in the cold storage at startup (e.g. after
+   a board started using the EEPROM) stays there until it's full. If the hot storage can't take a record, it goes
+   to the cold storage.
+
+   The space a store may use, and whether it may grow, is up to the cold storage: the hot storage only holds the
+   head segment.
+
+*/
+
+#ifndef HYDROMONITORTIEREDLOGSTORAGE_H
+#define HYDROMONITORTIEREDLOGSTORAGE_H
+
+#include <HydroMonitorLogStorage.h>
+
+const uint16_t TIER_SPILL_BLOCK = 512;                      // Bytes copied to the cold storage per write.
+const uint32_t NO_SEGMENT = 0xFFFFFFFF;
+
+class HydroMonitorTieredLogStorage : public HydroMonitorLogStorage
+{
+  public:
+    HydroMonitorTieredLogStorage(HydroMonitorLogStorage*, HydroMonitorLogStorage*);
+    void begin(const char*);
+    bool nextSegment(bool, uint32_t*, uint16_t*);
+    uint32_t capacity(uint8_t);
+    bool canGrow();
+    bool append(uint32_t, const uint8_t*, uint16_t);
+    uint16_t read(uint32_t, uint16_t, uint8_t*, uint16_t);
+    void cut(uint32_t, uint16_t);
+    void remove(uint32_t);
+
+  private:
+    void spill();
+
+    HydroMonitorLogStorage* hot;
+    HydroMonitorLogStorage* cold;
+    uint32_t hotHead;                                       // Newest segment in the hot storage.
+    uint32_t coldHead;                                      // Newest segment in the cold storage.
+    bool listingHot;                                        // nextSegment() is done with the cold storage.
+};
+#endif
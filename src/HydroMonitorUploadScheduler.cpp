@@ -0,0 +1,162 @@
+#include <HydroMonitorUploadScheduler.h>
+#include <HydroMonitorConnection.h>
+
+/*
+   Retry, backoff and rate limiting of the uploads to the logging server.
+*/
+
+/*
+   The constructor.
+*/
+HydroMonitorUploadScheduler::HydroMonitorUploadScheduler() {
+  for (uint8_t i = 0; i < N_FAILURE_TYPES; i++) {
+    failureCount[i] = 0;
+  }
+  for (uint8_t i = 0; i < UPLOAD_QUEUES; i++) {
+    credit[i] = 0;
+  }
+  retryDelay = 0;
+  throughput = 0;
+  recordCount = 0;
+  totalRecords = 0;
+  totalBytes = 0;
+  recoveryTime = 0;
+  maxRecoveryTime = 0;
+  drainRecords = 0;
+  drainTime = 0;
+  lastRefill = millis();
+  throughputStart = millis();
+}
+
+/*
+   Whether a new request may be started now: we're not waiting for a retry, and there's a token available.
+*/
+bool HydroMonitorUploadScheduler::ready() {
+  if (retryDelay > 0) {
+    if (millis() - failureTime < retryDelay) {
+      return false;
+    }
+    retryDelay = 0;                                         // Time to try again.
+  }
+  uint32_t elapsed = millis() - lastRefill;
+  lastRefill += elapsed;
+  tokens = min((float)UPLOAD_BURST, tokens + elapsed * uploadRate / 1000);
+  return tokens >= 1;
+}
+
+/*
+   A request was started: take its token.
+*/
+void HydroMonitorUploadScheduler::requestStarted() {
+  tokens -= 1;
+  if (draining == false) {                                  // First request of a new backlog.
+    draining = true;
+    drainStart = millis();
+    drainCount = 0;
+  }
+}
+
+/*
+   A request was successful: the server acknowledged n records, sent in bytes bytes.
+*/
+void HydroMonitorUploadScheduler::success(uint8_t n, uint16_t bytes) {
+  if (failures() > 0) {                                     // The end of an outage.
+    recoveryTime = millis() - outageStart;
+    maxRecoveryTime = max(maxRecoveryTime, recoveryTime);
+  }
+  totalRecords += n;
+  totalBytes += bytes;
+  drainCount += n;
+  for (uint8_t i = 0; i < N_FAILURE_TYPES; i++) {
+    failureCount[i] = 0;
+  }
+  retryDelay = 0;
+  uploadRate = min(MAX_UPLOAD_RATE, uploadRate + UPLOAD_RATE_STEP);
+  if (millis() - throughputStart > THROUGHPUT_INTERVAL) {
+    throughput = recordCount;
+    recordCount = 0;
+    throughputStart = millis();
+  }
+  recordCount += n;
+}
+
+/*
+   A request failed with responseCode: a negative CONNECTION_* code, or an HTTP response code.
+   Set the delay before the next attempt.
+*/
+void HydroMonitorUploadScheduler::failure(int16_t responseCode) {
+  FailureTypes type;
+  uint32_t delay;
+  if (responseCode == CONNECTION_DNS_FAILED) {
+    type = FAILURE_DNS;
+    delay = DNS_RETRY_DELAY;
+  }
+  else if (responseCode == CONNECTION_CONNECT_FAILED) {
+    type = FAILURE_CONNECT;
+    delay = CONNECT_RETRY_DELAY;
+  }
+  else {
+    type = FAILURE_SERVER;
+    delay = SERVER_RETRY_DELAY;
+  }
+  if (failures() == 0) {                                    // The start of an outage.
+    outageStart = millis();
+  }
+  if (failureCount[type] < 255) {
+    failureCount[type]++;
+  }
+  for (uint8_t i = 1; i < failureCount[type] && delay < MAX_RETRY_DELAY; i++) {
+    delay *= 2;
+  }
+  delay = min(delay, MAX_RETRY_DELAY);
+  retryDelay = delay / 2 + random(delay / 2);               // Jitter: somewhere between half and the full delay.
+  failureTime = millis();
+  uploadRate = max(MIN_UPLOAD_RATE, uploadRate / 2);
+}
+
+/*
+   All pending records have been acknowledged: the backlog is drained.
+*/
+void HydroMonitorUploadScheduler::drained() {
+  if (draining) {
+    draining = false;
+    drainRecords = drainCount;
+    drainTime = millis() - drainStart;
+  }
+}
+
+/*
+   Number of consecutive failures, of all types.
+*/
+uint8_t HydroMonitorUploadScheduler::failures() {
+  uint16_t total = 0;
+  for (uint8_t i = 0; i < N_FAILURE_TYPES; i++) {
+    total += failureCount[i];
+  }
+  return min(total, (uint16_t)255);
+}
+
+/*
+   Pick the queue to take the next request from. pending has bit i set if queue i has records waiting.
+   Ties go to the queue with the highest priority: the lowest number.
+*/
+HydroMonitorUploadScheduler::UploadQueues HydroMonitorUploadScheduler::next(uint8_t pending) {
+  int16_t totalWeight = 0;
+  int8_t best = -1;
+  for (uint8_t i = 0; i < UPLOAD_QUEUES; i++) {
+    if (bitRead(pending, i) == false) {                     // Nothing waiting: no credit carried over.
+      credit[i] = 0;
+      continue;
+    }
+    credit[i] += UPLOAD_QUEUE_WEIGHTS[i];
+    totalWeight += UPLOAD_QUEUE_WEIGHTS[i];
+    if (best < 0 || credit[i] > credit[best]) {
+      best = i;
+    }
+  }
+  if (best < 0) {
+    return QUEUE_NONE;
+  }
+  credit[best] -= totalWeight;
+  return (UploadQueues)best;
+}
@@ -0,0 +1,97 @@
+/*
+   HydroMonitorUploadScheduler
+
+   Decides when the next upload to the logging server may start.
+
+   Retries: after a failed request the uploader backs off, exponentially: the delay doubles with every consecutive
+   failure, up to MAX_RETRY_DELAY, and a random jitter spreads the retries of many devices after a server or
+   network outage. Failures are counted separately for DNS lookups, TCP connects and the server's response
+   (HTTP errors, time-outs), each with its own base delay. Any successful request resets all of them.
+
+   Rate limiting: each request takes a token from a bucket of UPLOAD_BURST tokens, which is refilled at
+   uploadRate tokens per second. The rate goes up a little with every successful request, and is halved with
+   every failure, so after an outage the backlog is drained at a pace the server keeps up with.
+
+   Throughput: the number of records acknowledged by the server is counted per minute.
+
+   Statistics: the records and bytes acknowledged since startup, how long the latest outage lasted (from the first
+   failure to the next success: the recovery time), and how fast the latest backlog was drained: from the first
+   request after the uploads were up to date until the caller reports with drained() that they are again.
+
+   Priorities: the records wait in UPLOAD_QUEUES queues - errors, warnings, data, and the other messages - and
+   next() picks the queue the next request is taken from, by smooth weighted round robin: every queue with pending
+   records earns its weight in credit per pick, and the one with the most credit is picked and pays the total
+   weight of the pending queues. So a queue gets a share of the requests in proportion to its weight, and none is
+   starved; as errors and warnings have the highest weights a new one is picked first, even behind a backlog of
+   hundreds of data records.
+
+*/
+
+#ifndef HYDROMONITORUPLOADSCHEDULER_H
+#define HYDROMONITORUPLOADSCHEDULER_H
+
+#include <Arduino.h>
+
+const uint32_t MAX_RETRY_DELAY = 60 * 60 * 1000ul;          // Longest wait before trying again (ms).
+const uint32_t DNS_RETRY_DELAY = 30 * 1000ul;               // First wait after a failed host name lookup (ms).
+const uint32_t CONNECT_RETRY_DELAY = 15 * 1000ul;           // First wait after a failed connect (ms).
+const uint32_t SERVER_RETRY_DELAY = 10 * 1000ul;            // First wait after an error response or time-out (ms).
+const uint8_t UPLOAD_BURST = 5;                             // Size of the token bucket.
+const float MIN_UPLOAD_RATE = 0.1;                          // Requests per second.
+const float MAX_UPLOAD_RATE = 2;                            // Requests per second.
+const float UPLOAD_RATE_STEP = 0.1;                         // Rate increase per successful request.
+const uint32_t THROUGHPUT_INTERVAL = 60 * 1000ul;           // Period over which the throughput is measured (ms).
+const uint8_t UPLOAD_QUEUES = 4;
+const uint8_t UPLOAD_QUEUE_WEIGHTS[UPLOAD_QUEUES] = {8, 4, 2, 1}; // Share of the requests: errors, warnings, data, messages.
+
+class HydroMonitorUploadScheduler
+{
+  public:
+
+    enum FailureTypes {
+      FAILURE_DNS,                                          // Host name could not be resolved.
+      FAILURE_CONNECT,                                      // No connection to the server.
+      FAILURE_SERVER,                                       // Error response, or no (complete) response.
+      N_FAILURE_TYPES,
+    };
+
+    enum UploadQueues {
+      QUEUE_ERRORS,                                         // Error messages.
+      QUEUE_WARNINGS,                                       // Warning messages.
+      QUEUE_DATA,                                           // Sensor data records.
+      QUEUE_MESSAGES,                                       // All messages, in order.
+      QUEUE_NONE,                                           // Nothing pending.
+    };
+
+    HydroMonitorUploadScheduler();
+    bool ready();
+    void requestStarted();
+    void success(uint8_t, uint16_t);
+    void failure(int16_t);
+    void drained();
+    uint8_t failures();
+    UploadQueues next(uint8_t);
+    uint32_t retryDelay;                                    // Wait after the latest failure (ms); 0 if not failing.
+    float uploadRate = 1;                                   // Token refill rate (requests per second).
+    uint16_t throughput;                                    // Records acknowledged in the last complete minute.
+    uint32_t totalRecords;                                  // Records acknowledged since startup.
+    uint32_t totalBytes;                                    // Bytes sent for these records.
+    uint32_t recoveryTime;                                  // Duration of the latest outage (ms).
+    uint32_t maxRecoveryTime;                               // Duration of the longest outage (ms).
+    uint32_t drainRecords;                                  // Records in the latest drained backlog.
+    uint32_t drainTime;                                     // Time it took to drain it (ms).
+
+  private:
+    uint8_t failureCount[N_FAILURE_TYPES];                  // Consecutive failures, per type.
+    uint32_t failureTime;                                   // Time of the latest failure.
+    uint32_t outageStart;                                   // Time of the first of the consecutive failures.
+    bool draining = false;                                  // There's a backlog of records being uploaded.
+    uint32_t drainStart;
+    uint32_t drainCount;                                    // Records of the backlog acknowledged so far.
+    float tokens = UPLOAD_BURST;
+    uint32_t lastRefill;
+    uint16_t recordCount;                                   // Records acknowledged in the current minute.
+    uint32_t throughputStart;
+    int16_t credit[UPLOAD_QUEUES];                          // Credit of each queue in the weighted round robin.
+};
+#endif
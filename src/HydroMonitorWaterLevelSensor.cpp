@@ -22,7 +22,7 @@ void HydroMonitorWaterLevelSensor::begin(HydroMonitorCore::SensorData *sd, Hydro
   // Set the parameters.
   mcp23008 = mcp;
   mcp23008->pinMode(TRIG_MCP_PIN, OUTPUT);
-  l->writeTrace(F("HydroMonitorWaterLevelSensor: configured HC-SR04 sensor with trig pin on MCP port expander."));
+  l->writeTrace(LOG_MODULE_WATERLEVELSENSOR, F("HydroMonitorWaterLevelSensor: configured HC-SR04 sensor with trig pin on MCP port expander."));
 
 #elif defined(TRIG_PCF_PIN)
 /*
@@ -32,7 +32,7 @@ void HydroMonitorWaterLevelSensor::begin(HydroMonitorCore::SensorData * sd, Hydr
 
   // Set the parameters.
   pcf8574 = pcf;
-  l->writeTrace(F("HydroMonitorWaterLevelSensor: configured HC-SR04 sensor with trig pin on PCF port expander."));
+  l->writeTrace(LOG_MODULE_WATERLEVELSENSOR, F("HydroMonitorWaterLevelSensor: configured HC-SR04 sensor with trig pin on PCF port expander."));
 
 #elif defined(TRIG_PIN)
 /*
@@ -42,11 +42,11 @@ void HydroMonitorWaterLevelSensor::begin(HydroMonitorCore::SensorData * sd, Hydr
 
   // Set the parameters.
   pinMode(TRIG_PIN, OUTPUT);
-  l->writeTrace(F("HydroMonitorWaterLevelSensor: configured HC-SR04 sensor."));
+  l->writeTrace(LOG_MODULE_WATERLEVELSENSOR, F("HydroMonitorWaterLevelSensor: configured HC-SR04 sensor."));
 #endif
 
   pinMode(ECHO_PIN, INPUT);
-  l->writeTrace(F("HydroMonitorWaterLevelSensor: set up HC-SR04 sensor."));
+  l->writeTrace(LOG_MODULE_WATERLEVELSENSOR, F("HydroMonitorWaterLevelSensor: set up HC-SR04 sensor."));
 
   /*
      MS5837 pressure sensor.
@@ -56,7 +56,7 @@ void HydroMonitorWaterLevelSensor::begin(HydroMonitorCore::SensorData * sd, Hydr
 
   // Set the parameters.
   ms5837 = ms;
-  l->writeTrace(F("HydroMonitorWaterLevelSensor: set up MS5837 sensor."));
+  l->writeTrace(LOG_MODULE_WATERLEVELSENSOR, F("HydroMonitorWaterLevelSensor: set up MS5837 sensor."));
 
   /*
      DS1603L ultrasound sensor.
@@ -120,12 +120,12 @@ void HydroMonitorWaterLevelSensor::begin(HydroMonitorCore::SensorData * sd, Hydr
   // Note: for some sensors the reservoir heights are in cm, for others it's the ADC reading.
 #ifdef USE_MPXV5004
   if (settings.reservoirHeight < 250 || settings.reservoirHeight > 1024) {
-    l->writeTrace(F("HydroMonitorWaterLevelSensor: applying default settings."));
+    l->writeTrace(LOG_MODULE_WATERLEVELSENSOR, F("HydroMonitorWaterLevelSensor: applying default settings."));
     settings.reservoirHeight = 650;
     settings.zeroLevel = 300;
 #else
   if (settings.reservoirHeight < 1 || settings.reservoirHeight > 120) {
-    l->writeTrace(F("HydroMonitorWaterLevelSensor: applying default settings."));
+    l->writeTrace(LOG_MODULE_WATERLEVELSENSOR, F("HydroMonitorWaterLevelSensor: applying default settings."));
     settings.reservoirHeight = 30;
     settings.zeroLevel = 0;
 #endif
@@ -388,9 +388,7 @@ void HydroMonitorWaterLevelSensor::warning() {
   // Send warning if it's been long enough ago & fill is <40%.
   if (millis() - lastWarned > WARNING_INTERVAL && sensorData->waterLevel >= 0 && sensorData->waterLevel < 20) {
     lastWarned += WARNING_INTERVAL;
-    char message[140];
-    sprintf_P(message, PSTR("WaterLevelSensor 01: the reservoir is almost empty, and is in urgent need of a refill. Current reservoir fill level:  %.1f %%."), sensorData->waterLevel);
-    logging->writeWarning(message);
+    logging->writeWarning(MESSAGE_WATERLEVELSENSOR_01, sensorData->waterLevel);
   }
 }
 
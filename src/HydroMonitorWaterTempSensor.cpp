@@ -16,17 +16,17 @@ HydroMonitorWaterTempSensor::HydroMonitorWaterTempSensor () {
 #ifdef NTC_ADS_PIN
 void HydroMonitorWaterTempSensor::begin(HydroMonitorCore::SensorData *sd, HydroMonitorLogging *l, Adafruit_ADS1115 *ads) {
   ads1115 = ads;
-  l->writeTrace(F("HydroMonitorWaterTempSensor: configured NTC probe on ADS port expander."));
+  l->writeTrace(LOG_MODULE_WATERTEMPSENSOR, F("HydroMonitorWaterTempSensor: configured NTC probe on ADS port expander."));
 
 #elif defined(NTC_PIN)
 void HydroMonitorWaterTempSensor::begin(HydroMonitorCore::SensorData * sd, HydroMonitorLogging * l) {
-  l->writeTrace(F("HydroMonitorWaterTempSensor: configured NTC probe."));
+  l->writeTrace(LOG_MODULE_WATERTEMPSENSOR, F("HydroMonitorWaterTempSensor: configured NTC probe."));
 #endif
 
 #elif defined(USE_MS5837)
 void HydroMonitorWaterTempSensor::begin(HydroMonitorCore::SensorData * sd, HydroMonitorLogging * l, MS5837 * ms) {
   ms5837 = ms;
-  l->writeTrace(F("HydroMonitorWaterTempSensor: configured MS5837 sensor."));
+  l->writeTrace(LOG_MODULE_WATERTEMPSENSOR, F("HydroMonitorWaterTempSensor: configured MS5837 sensor."));
 
 #elif defined(USE_DS18B20)
 void HydroMonitorWaterTempSensor::begin(HydroMonitorCore::SensorData * sd, HydroMonitorLogging * l, DallasTemperature * ds) {
@@ -35,15 +35,15 @@ void HydroMonitorWaterTempSensor::begin(HydroMonitorCore::SensorData * sd, Hydro
   ds18b20->setWaitForConversion(false);
   startConversion();
   if (sensorPresent) {
-    l->writeTrace(F("WaterTempSensor: configured DS18B20 sensor."));
+    l->writeTrace(LOG_MODULE_WATERTEMPSENSOR, F("WaterTempSensor: configured DS18B20 sensor."));
   }
   else {
-    l->writeError(F("WaterTempSensor 10: no DS18B20 temperature sensor found."));
+    l->writeError(MESSAGE_WATERTEMPSENSOR_10);
   }
 
 #elif defined(USE_ISOLATED_SENSOR_BOARD)
 void HydroMonitorWaterTempSensor::begin(HydroMonitorCore::SensorData * sd, HydroMonitorLogging * l) {
-  l->writeTrace(F("HydroMonitorWaterTempSensor: configured isolated sensor board."));
+  l->writeTrace(LOG_MODULE_WATERTEMPSENSOR, F("HydroMonitorWaterTempSensor: configured isolated sensor board."));
 #endif
 
   sensorData = sd;
@@ -144,10 +144,7 @@ void HydroMonitorWaterTempSensor::readSensor(bool readNow) {
   if (millis() - lastWarned > WARNING_INTERVAL &&
       (sensorData->waterTemp < 5 || sensorData->waterTemp > 70)) {
     lastWarned = millis();
-    char message[120];
-    sprintf_P(message, PSTR("WaterTempSensor 01: unusual temperature value measured: %2.1f °C. Check water temperature sensor."),
-              sensorData->waterTemp);
-    logging->writeWarning(message);
+    logging->writeWarning(MESSAGE_WATERTEMPSENSOR_01, sensorData->waterTemp);
   }
 }
 
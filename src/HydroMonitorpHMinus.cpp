@@ -26,13 +26,13 @@ HydroMonitorpHMinus::HydroMonitorpHMinus() {
 void HydroMonitorpHMinus::begin(HydroMonitorCore::SensorData *sd, HydroMonitorLogging *l, Adafruit_MCP23008 *mcp23008) {
   mcp = mcp23008;
   mcp->pinMode(PHMINUS_MCP_PIN, OUTPUT);
-  l->writeTrace(F("HydroMonitorpHMinus: configured pH-minus adjuster on MCP23008 port expander."));
+  l->writeTrace(LOG_MODULE_PHMINUS, F("HydroMonitorpHMinus: configured pH-minus adjuster on MCP23008 port expander."));
 
 #elif defined(PHMINUS_MCP17_PIN)
 void HydroMonitorpHMinus::begin(HydroMonitorCore::SensorData * sd, HydroMonitorLogging * l, Adafruit_MCP23017 * mcp23017) {
   mcp = mcp23017;
   mcp->pinMode(PHMINUS_MCP17_PIN, OUTPUT);
-  l->writeTrace(F("HydroMonitorpHMinus: configured pH-minus adjuster on MCP23017 port expander."));
+  l->writeTrace(LOG_MODULE_PHMINUS, F("HydroMonitorpHMinus: configured pH-minus adjuster on MCP23017 port expander."));
 
   /*
      Setup the pH minus pump.
@@ -42,7 +42,7 @@ void HydroMonitorpHMinus::begin(HydroMonitorCore::SensorData * sd, HydroMonitorL
 void HydroMonitorpHMinus::begin(HydroMonitorCore::SensorData * sd, HydroMonitorLogging * l, PCF857x * pcf) {
   pcf8574 = pcf;
   pcf8574->pinMode(PHMINUS_PCF_PIN, OUTPUT);
-  l->writeTrace(F("HydroMonitorpHMinus: configured pH-minus adjuster on PCF8574 port expander."));
+  l->writeTrace(LOG_MODULE_PHMINUS, F("HydroMonitorpHMinus: configured pH-minus adjuster on PCF8574 port expander."));
 
   /*
      Setup the pH minus pump - direct connection.
@@ -50,7 +50,7 @@ void HydroMonitorpHMinus::begin(HydroMonitorCore::SensorData * sd, HydroMonitorL
 #elif defined(PHMINUS_PIN)
 void HydroMonitorpHMinus::begin(HydroMonitorCore::SensorData * sd, HydroMonitorLogging * l) {
   pinMode(PHMINUS_PIN, OUTPUT);
-  l->writeTrace(F("HydroMonitorpHMinus: configured pH-minus adjuster."));
+  l->writeTrace(LOG_MODULE_PHMINUS, F("HydroMonitorpHMinus: configured pH-minus adjuster."));
 #endif
 
   sensorData = sd;
@@ -65,7 +65,7 @@ void HydroMonitorpHMinus::begin(HydroMonitorCore::SensorData * sd, HydroMonitorL
 
   // Check whether any settings have been set, if not apply defaults.
   if (settings.pumpSpeed < 0 || settings.pumpSpeed > 200) {
-    l->writeTrace(F("HydroMonitorpHMinus: applying default settings."));
+    l->writeTrace(LOG_MODULE_PHMINUS, F("HydroMonitorpHMinus: applying default settings."));
     settings.pumpSpeed = 20;      // ml per minute.
 #ifdef USE_24LC256_EEPROM
     sensorData->EEPROM->put(PHMINUS_EEPROM, settings);
@@ -93,7 +93,7 @@ void HydroMonitorpHMinus::dopH() {
   // If we're measuring the pump speed, switch it off after 60 seconds.
   if (measuring) {
     if (millis() - startTime > 60 * 1000ul) {
-      logging->writeTrace(F("HydroMonitorpHMinus: measuring pump finished."));
+      logging->writeTrace(LOG_MODULE_PHMINUS, F("HydroMonitorpHMinus: measuring pump finished."));
       switchPumpOff();
       measuring = false;
       running = false;
@@ -122,7 +122,7 @@ void HydroMonitorpHMinus::dopH() {
   // Check whether pH-minus is running, and if so whether it's time to stop.
   if (running) {
     if (millis() - startTime > runTime) {
-      logging->writeTrace(F("HydroMonitorpHMinus: finished adding pH-minus; switching off the pump."));
+      logging->writeTrace(LOG_MODULE_PHMINUS, F("HydroMonitorpHMinus: finished adding pH-minus; switching off the pump."));
       switchPumpOff();
       running = false;
       lastTimeAdded = millis();
@@ -154,10 +154,12 @@ void HydroMonitorpHMinus::dopH() {
   else if (millis() - lastGoodpH > 10 * 60 * 1000ul) {
     float addVolume = 0.2 * sensorData->solutionVolume * sensorData->pHMinusConcentration; // The amount of fertiliser in ml to be added.
     runTime = (addVolume / settings.pumpSpeed) * 60 * 1000ul; // the time in milliseconds pump A has to run.
-    logging->writeTrace(F("HydroMonitorpHMinus: 10 minutes of too high pH; start adding pH-minus."));
-    char buff[100];
-    sprintf_P(buff, PSTR("HydroMonitorpHMinus: running pump for %i ms to add %3.1f ml of pH- solution."), runTime, addVolume);
-    logging->writeInfo(buff);
+    logging->writeTrace(LOG_MODULE_PHMINUS, F("HydroMonitorpHMinus: 10 minutes of too high pH; start adding pH-minus."));
+    if (logging->isLogged(LOG_MODULE_PHMINUS, LOG_INFO)) {
+      char buff[100];
+      sprintf_P(buff, PSTR("HydroMonitorpHMinus: running pump for %i ms to add %3.1f ml of pH- solution."), runTime, addVolume);
+      logging->writeInfo(LOG_MODULE_PHMINUS, buff);
+    }
     switchPumpOn();                                         // Start the pump.
     running = true;                                         // Flag it's running.
     startTime = millis();                                   // Keep track of since when it's running.
@@ -170,7 +172,7 @@ void HydroMonitorpHMinus::dopH() {
     }
   }
   else if (originalpH < 14 && millis() - lastWarned > WARNING_INTERVAL) {
-    logging->writeWarning(F("pHMinus 01: pH did not go down as expected after running the pump. pH- bottle may be empty."));
+    logging->writeWarning(MESSAGE_PHMINUS_01);
     lastWarned = millis();
   }
 }
@@ -179,6 +181,7 @@ void HydroMonitorpHMinus::dopH() {
    Functions to switch the pump on and off.
 */
 void HydroMonitorpHMinus::switchPumpOn() {
+  bitSet(sensorData->systemStatus, STATUS_DOSING_PHMINUS);
 #ifdef PHMINUS_PIN
   digitalWrite(PHMINUS_PIN, HIGH);
 #elif defined(PHMINUS_PCF_PIN)
@@ -191,6 +194,7 @@ void HydroMonitorpHMinus::switchPumpOn() {
 }
 
 void HydroMonitorpHMinus::switchPumpOff() {
+  bitClear(sensorData->systemStatus, STATUS_DOSING_PHMINUS);
 #ifdef PHMINUS_PIN
   digitalWrite(PHMINUS_PIN, LOW);
 #elif defined(PHMINUS_PCF_PIN)
@@ -206,7 +210,7 @@ void HydroMonitorpHMinus::switchPumpOff() {
 // This is called via the web interface or the app interface.
 void HydroMonitorpHMinus::measurePump() {
   if (!running) { // Don't do anything if the pump is running already.
-    logging->writeTrace(F("HydroMonitorpHMinus: switching on pH- pump."));
+    logging->writeTrace(LOG_MODULE_PHMINUS, F("HydroMonitorpHMinus: switching on pH- pump."));
     switchPumpOn();
     startTime = millis();
     running = true;
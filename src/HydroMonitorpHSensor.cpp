@@ -16,7 +16,7 @@ HydroMonitorpHSensor::HydroMonitorpHSensor() {
 #ifdef PH_SENSOR_ADS_PIN
 void HydroMonitorpHSensor::begin(HydroMonitorCore::SensorData *sd, HydroMonitorLogging *l, Adafruit_ADS1115 *ads) {
   ads1115 = ads;
-  l->writeTrace(F("HydroMonitorpHSensor: configured pH sensor on ADS port expander."));
+  l->writeTrace(LOG_MODULE_PHSENSOR, F("HydroMonitorpHSensor: configured pH sensor on ADS port expander."));
 
   /*
      Setup the sensor.
@@ -24,7 +24,7 @@ void HydroMonitorpHSensor::begin(HydroMonitorCore::SensorData *sd, HydroMonitorL
   */
 #elif defined(PH_SENSOR_PIN) || defined(USE_ISOLATED_SENSOR_BOARD)
 void HydroMonitorpHSensor::begin(HydroMonitorCore::SensorData * sd, HydroMonitorLogging * l) {
-  l->writeTrace(F("HydroMonitorpHSensor: configured pH sensor."));
+  l->writeTrace(LOG_MODULE_PHSENSOR, F("HydroMonitorpHSensor: configured pH sensor."));
 #endif
   sensorData = sd;
   logging = l;
@@ -82,15 +82,11 @@ void HydroMonitorpHSensor::readSensor(bool readNow) {
     if (millis() - lastWarned > WARNING_INTERVAL) {
       if (sensorData->pH > 9 || sensorData->pH < 4) {
         lastWarned = millis();
-        char message[70];
-        sprintf_P(message, PSTR("pHSensor 01: unusual pH level measured: %2.2f. Check sensor."), sensorData->pH);
-        logging->writeWarning(message);
+        logging->writeWarning(MESSAGE_PHSENSOR_01, sensorData->pH);
       }
       else if (sensorData->pH > sensorData->targetpH + 1) {
         lastWarned = millis();
-        char message[140];
-        sprintf_P(message, PSTR("pHSensor 02: pH level is too high; correction with pH adjuster is urgently needed. Target set: %2.2f, current pH: %2.2f."), sensorData->targetpH, sensorData->pH);
-        logging->writeWarning(message);
+        logging->writeWarning(MESSAGE_PHSENSOR_02, sensorData->targetpH, sensorData->pH);
       }
     }
   }
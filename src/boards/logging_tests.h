@@ -4,7 +4,12 @@
 // How to do the logging.
 #define LOG_SERIAL  // Send log info to the Serial console.
 #define LOG_MYSQL   // Send log info to the MySQL database.
+#define LOG_BATCH_MESSAGES  // Include pending messages in batch uploads.
+//#define LOG_MQTT          // Publish to an MQTT broker instead of uploading to the HTTP server.
+//#define LOG_LITTLEFS      // Keep the logs in LittleFS instead of SPIFFS (wipes the logs).
 #define USE_SERIAL
+//#define UPLOAD_TEST_LATENCY 1500  // Test: hold back every server response at least this long (ms).
+//#define UPLOAD_TEST_FAILURES 20   // Test: percentage of uploads that fail.
 
 #define OTA_PASSWORD "esp"
 #define LOGGING_USERNAME "sql_username"           // MySQL user name. It's a string, so needs the quote marks.